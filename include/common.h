@@ -137,6 +137,15 @@ typedef struct {
   pid_t cur_pid;
   FILE *outFile_st;
   int parser_type;  /* Parser type selection */
+  int threads;      /* Number of parser worker threads */
+  int follow;       /* Keep reading files as they grow */
+  int shapeCache;   /* Reuse parses of repeated line shapes */
+  int teardown;     /* Free everything before exiting */
+  int sortKey;      /* Report order, SORT_* */
+  int topCount;     /* Only report the most seen templates */
+  int bottomCount;  /* Only report the least seen templates */
+  int writeDb;      /* -w writes a binary template database */
+  int estimate;     /* Estimate distinct values of variable fields */
 } Config_t;
 
 #endif	/* end of COMMON_H */
@@ -66,6 +66,10 @@
 # define ETHERTYPE_IP ETH_P_IP
 #endif
 
+#ifdef HAVE_MATH_H
+# include <math.h>
+#endif
+
 #ifdef HAVE_MEMORY_H
 # include <memory.h>
 #endif
@@ -126,6 +130,14 @@
 # include <paths.h>
 #endif
 
+#ifdef HAVE_POLL_H
+# include <poll.h>
+#endif
+
+#ifdef HAVE_PTHREAD_H
+# include <pthread.h>
+#endif
+
 #ifdef HAVE_SIGNAL_H
 # include <signal.h>
 #endif
@@ -172,6 +184,14 @@
 # include <sys/ioctl.h>
 #endif
 
+#ifdef HAVE_SYS_INOTIFY_H
+# include <sys/inotify.h>
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
+
 #ifdef HAVE_SYS_NDIR_H
 # include <sys/ndir.h>
 #endif
@@ -198,6 +218,10 @@
 /*@=skipposixheaders@*/
 #endif
 
+#ifdef HAVE_SYS_UIO_H
+# include <sys/uio.h>
+#endif
+
 #ifdef HAVE_SYS_SOCKIO_H
 # include <sys/sockio.h>
 #endif
@@ -222,4 +246,21 @@
 /*@-skipposixheaders@*/
 #endif
 
+#if defined(HAVE_ZLIB_H) && defined(HAVE_LIBZ)
+# define ZLIB_CONST
+# include <zlib.h>
+#endif
+
+#if defined(HAVE_ZSTD_H) && defined(HAVE_LIBZSTD)
+# include <zstd.h>
+#endif
+
+#if defined(HAVE_LZMA_H) && defined(HAVE_LIBLZMA)
+# include <lzma.h>
+#endif
+
+#if defined(HAVE_BZLIB_H) && defined(HAVE_LIBBZ2)
+# include <bzlib.h>
+#endif
+
 #endif /* __SYSDEP_H__ */
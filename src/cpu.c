@@ -0,0 +1,106 @@
+/*****
+ *
+ * Description: CPU Feature Detection
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "cpu.h"
+
+/****
+ *
+ * external global variables
+ *
+ ****/
+
+extern Config_t *config;
+
+/****
+ *
+ * local variables
+ *
+ ****/
+
+PRIVATE uint32_t cpuFeatures = 0;
+PRIVATE int cpuDetected = FALSE;
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * find out what the running cpu supports
+ *
+ * DESCRIPTION:
+ *   Kernels are picked from what the cpu the binary runs on supports,
+ *   not what the build box supported.  __builtin_cpu_supports() also
+ *   checks that the OS saves the wider registers.
+ *
+ * PRECONDITIONS:
+ *   Called from main() before any thread is started
+ *
+ * POSTCONDITIONS:
+ *   cpuHas() answers for the running cpu, later calls do nothing
+ *
+ ****/
+
+void initCpuFeatures(void)
+{
+  if (cpuDetected)
+    return;
+  cpuDetected = TRUE;
+
+#ifdef CPU_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.2"))
+    cpuFeatures |= CPU_SSE42;
+  if (__builtin_cpu_supports("avx2"))
+    cpuFeatures |= CPU_AVX2;
+  if (__builtin_cpu_supports("avx512bw"))
+    cpuFeatures |= CPU_AVX512BW;
+#endif
+
+  if (config->debug >= 2)
+    fprintf(stderr, "DEBUG - CPU features:%s%s%s%s\n",
+            (cpuFeatures & CPU_SSE42) ? " sse4.2" : "",
+            (cpuFeatures & CPU_AVX2) ? " avx2" : "",
+            (cpuFeatures & CPU_AVX512BW) ? " avx512bw" : "",
+            (cpuFeatures == 0) ? " none" : "");
+}
+
+/****
+ *
+ * TRUE when the running cpu has every feature in the mask
+ *
+ ****/
+
+int cpuHas(uint32_t feature)
+{
+  if (!cpuDetected)
+    initCpuFeatures();
+  return ((cpuFeatures & feature) == feature);
+}
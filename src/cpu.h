@@ -0,0 +1,74 @@
+/*****
+ *
+ * Description: CPU Feature Detection Headers
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#ifndef CPU_DOT_H
+#define CPU_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+/*
+ * kernels for newer instruction sets are compiled with CPU_TARGET()
+ * so the rest of the build stays portable, cpuHas() says whether the
+ * running cpu can execute them
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CPU_X86 1
+#include <immintrin.h>
+#define CPU_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+#define CPU_SSE42 0x01
+#define CPU_AVX2 0x02
+#define CPU_AVX512BW 0x04
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+void initCpuFeatures(void);
+int cpuHas(uint32_t feature);
+
+#endif /* CPU_DOT_H */
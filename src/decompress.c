@@ -0,0 +1,719 @@
+/*****
+ *
+ * Description: Compressed Input Decoder Functions
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "decompress.h"
+
+#if defined(HAVE_ZLIB_H) && defined(HAVE_LIBZ)
+# define HAVE_GZIP_DECODER 1
+#endif
+#if defined(HAVE_ZSTD_H) && defined(HAVE_LIBZSTD)
+# define HAVE_ZSTD_DECODER 1
+#endif
+#if defined(HAVE_LZMA_H) && defined(HAVE_LIBLZMA)
+# define HAVE_XZ_DECODER 1
+#endif
+#if defined(HAVE_BZLIB_H) && defined(HAVE_LIBBZ2)
+# define HAVE_BZIP2_DECODER 1
+#endif
+
+/****
+ *
+ * local typedefs & structs
+ *
+ ****/
+
+#ifdef HAVE_PTHREAD_H
+/* decompressed data waiting for the line reader */
+struct decodedBlock_s
+{
+  char *buf;
+  size_t len;
+};
+#endif
+
+struct decoder_s
+{
+  int format;
+  int fd;                                  /* -1 when all input is in data */
+  unsigned char *inBuf;
+  size_t inBufSize;
+  const unsigned char *nextIn;
+  size_t availIn;
+  int inEof;
+  int streamEnd;                           /* last member or frame was complete */
+  int finished;
+#ifdef HAVE_GZIP_DECODER
+  z_stream gz;
+#endif
+#ifdef HAVE_ZSTD_DECODER
+  ZSTD_DStream *zs;
+#endif
+#ifdef HAVE_XZ_DECODER
+  lzma_stream xz;
+#endif
+#ifdef HAVE_BZIP2_DECODER
+  bz_stream bz;
+#endif
+#ifdef HAVE_PTHREAD_H
+  pthread_t thread;
+  int threaded;
+  pthread_mutex_t lock;
+  pthread_cond_t notEmpty;
+  pthread_cond_t notFull;
+  struct decodedBlock_s blocks[DECODER_BLOCKS];
+  int head;                                /* block being read */
+  int count;                               /* blocks ready */
+  size_t readPos;
+  int done;
+  int error;
+  int cancel;
+#endif
+};
+
+/****
+ *
+ * external variables
+ *
+ ****/
+
+extern Config_t *config;
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * identify a compressed stream by its magic bytes
+ *
+ ****/
+
+int detectCompression(const unsigned char *buf, size_t len)
+{
+  if ((len >= 3) && (buf[0] == 0x1f) && (buf[1] == 0x8b) && (buf[2] == 0x08))
+    return COMPRESS_GZIP;
+  if ((len >= 4) && (buf[0] == 0x28) && (buf[1] == 0xb5) && (buf[2] == 0x2f) && (buf[3] == 0xfd))
+    return COMPRESS_ZSTD;
+  if ((len >= 6) && (memcmp(buf, "\xfd" "7zXZ\0", 6) == 0))
+    return COMPRESS_XZ;
+  if ((len >= 4) && (buf[0] == 'B') && (buf[1] == 'Z') && (buf[2] == 'h') && (buf[3] >= '1') && (buf[3] <= '9'))
+    return COMPRESS_BZIP2;
+
+  return COMPRESS_NONE;
+}
+
+/****
+ *
+ * format name for messages
+ *
+ ****/
+
+const char *compressionName(int format)
+{
+  switch (format)
+  {
+  case COMPRESS_GZIP:
+    return "gzip";
+  case COMPRESS_ZSTD:
+    return "zstd";
+  case COMPRESS_XZ:
+    return "xz";
+  case COMPRESS_BZIP2:
+    return "bzip2";
+  }
+  return "uncompressed";
+}
+
+/****
+ *
+ * was this build linked with a decoder for the format
+ *
+ ****/
+
+int compressionSupported(int format)
+{
+  switch (format)
+  {
+#ifdef HAVE_GZIP_DECODER
+  case COMPRESS_GZIP:
+    return TRUE;
+#endif
+#ifdef HAVE_ZSTD_DECODER
+  case COMPRESS_ZSTD:
+    return TRUE;
+#endif
+#ifdef HAVE_XZ_DECODER
+  case COMPRESS_XZ:
+    return TRUE;
+#endif
+#ifdef HAVE_BZIP2_DECODER
+  case COMPRESS_BZIP2:
+    return TRUE;
+#endif
+  case COMPRESS_NONE:
+    return TRUE;
+  }
+  return FALSE;
+}
+
+/****
+ *
+ * make sure there is compressed input to work on, FALSE at eof
+ *
+ ****/
+
+PRIVATE int refillInput(decoder_t *dec)
+{
+  ssize_t rCount;
+
+  if (dec->availIn > 0)
+    return TRUE;
+
+  while (!dec->inEof && (dec->fd != -1))
+  {
+    if ((rCount = read(dec->fd, dec->inBuf, dec->inBufSize)) > 0)
+    {
+      dec->nextIn = dec->inBuf;
+      dec->availIn = (size_t)rCount;
+      return TRUE;
+    }
+    if ((rCount == -1) && (errno == EINTR))
+      continue;
+    if (rCount == -1)
+      fprintf(stderr, "ERR - Read failed %d (%s)\n", errno, strerror(errno));
+    dec->inEof = TRUE;
+  }
+  dec->inEof = TRUE;
+
+  return FALSE;
+}
+
+#ifdef HAVE_GZIP_DECODER
+/****
+ *
+ * inflate gzip members, concatenated members are read back to back
+ *
+ ****/
+
+PRIVATE ssize_t decodeGzip(decoder_t *dec, char *out, size_t outSize)
+{
+  uInt before;
+  int have, ret;
+
+  dec->gz.next_out = (Bytef *)out;
+  dec->gz.avail_out = (uInt)outSize;
+
+  while (dec->gz.avail_out > 0)
+  {
+    have = refillInput(dec);
+    if (dec->streamEnd)
+    {
+      if (!have)
+        break;
+      inflateReset(&dec->gz);
+      dec->streamEnd = FALSE;
+    }
+
+    dec->gz.next_in = dec->nextIn;
+    dec->gz.avail_in = (dec->availIn > DECODER_MAX_FEED) ? DECODER_MAX_FEED : (uInt)dec->availIn;
+    before = dec->gz.avail_out;
+    ret = inflate(&dec->gz, Z_NO_FLUSH);
+    dec->availIn -= (size_t)(dec->gz.next_in - dec->nextIn);
+    dec->nextIn = dec->gz.next_in;
+
+    if (ret == Z_STREAM_END)
+      dec->streamEnd = TRUE;
+    else if ((ret != Z_OK) && (ret != Z_BUF_ERROR))
+    {
+      fprintf(stderr, "ERR - Corrupt gzip input (%s)\n", (dec->gz.msg != NULL) ? dec->gz.msg : "unknown error");
+      return -1;
+    }
+    else if (!have && (dec->gz.avail_out == before))
+      break;
+  }
+
+  return (ssize_t)(outSize - dec->gz.avail_out);
+}
+#endif
+
+#ifdef HAVE_ZSTD_DECODER
+/****
+ *
+ * decompress zstd frames
+ *
+ ****/
+
+PRIVATE ssize_t decodeZstd(decoder_t *dec, char *out, size_t outSize)
+{
+  ZSTD_outBuffer oBuf;
+  ZSTD_inBuffer iBuf;
+  size_t before, ret;
+  int have;
+
+  oBuf.dst = out;
+  oBuf.size = outSize;
+  oBuf.pos = 0;
+
+  while (oBuf.pos < oBuf.size)
+  {
+    have = refillInput(dec);
+    iBuf.src = dec->nextIn;
+    iBuf.size = have ? dec->availIn : 0;
+    iBuf.pos = 0;
+    before = oBuf.pos;
+    ret = ZSTD_decompressStream(dec->zs, &oBuf, &iBuf);
+    dec->nextIn += iBuf.pos;
+    dec->availIn -= iBuf.pos;
+
+    if (ZSTD_isError(ret))
+    {
+      fprintf(stderr, "ERR - Corrupt zstd input (%s)\n", ZSTD_getErrorName(ret));
+      return -1;
+    }
+    if (!have && (oBuf.pos == before))
+      break;
+    /* 0 means the frame is complete and fully flushed */
+    dec->streamEnd = (ret == 0);
+  }
+
+  return (ssize_t)oBuf.pos;
+}
+#endif
+
+#ifdef HAVE_XZ_DECODER
+/****
+ *
+ * decompress xz streams
+ *
+ ****/
+
+PRIVATE ssize_t decodeXz(decoder_t *dec, char *out, size_t outSize)
+{
+  lzma_ret ret;
+  size_t before;
+  int have;
+
+  dec->xz.next_out = (uint8_t *)out;
+  dec->xz.avail_out = outSize;
+
+  while ((dec->xz.avail_out > 0) && !dec->streamEnd)
+  {
+    have = refillInput(dec);
+    dec->xz.next_in = dec->nextIn;
+    dec->xz.avail_in = have ? dec->availIn : 0;
+    before = dec->xz.avail_out;
+    ret = lzma_code(&dec->xz, have ? LZMA_RUN : LZMA_FINISH);
+    dec->availIn -= (size_t)(dec->xz.next_in - dec->nextIn);
+    dec->nextIn = dec->xz.next_in;
+
+    if (ret == LZMA_STREAM_END)
+      dec->streamEnd = TRUE;
+    else if ((ret == LZMA_BUF_ERROR) && !have)
+      break;
+    else if (ret != LZMA_OK)
+    {
+      fprintf(stderr, "ERR - Corrupt xz input (error %d)\n", (int)ret);
+      return -1;
+    }
+    else if (!have && (dec->xz.avail_out == before))
+      break;
+  }
+
+  return (ssize_t)(outSize - dec->xz.avail_out);
+}
+#endif
+
+#ifdef HAVE_BZIP2_DECODER
+/****
+ *
+ * decompress bzip2 streams, concatenated streams are read back to back
+ *
+ ****/
+
+PRIVATE ssize_t decodeBzip2(decoder_t *dec, char *out, size_t outSize)
+{
+  unsigned int before;
+  int have, ret;
+
+  dec->bz.next_out = out;
+  dec->bz.avail_out = (unsigned int)outSize;
+
+  while (dec->bz.avail_out > 0)
+  {
+    have = refillInput(dec);
+    if (dec->streamEnd)
+    {
+      if (!have)
+        break;
+      before = dec->bz.avail_out;
+      BZ2_bzDecompressEnd(&dec->bz);
+      XMEMSET(&dec->bz, 0, sizeof(bz_stream));
+      if (BZ2_bzDecompressInit(&dec->bz, 0, 0) != BZ_OK)
+      {
+        fprintf(stderr, "ERR - Unable to restart bzip2 decoder\n");
+        return -1;
+      }
+      dec->bz.next_out = out + (outSize - before);
+      dec->bz.avail_out = before;
+      dec->streamEnd = FALSE;
+    }
+
+    /* libbz2 never writes through next_in */
+    dec->bz.next_in = (char *)(uintptr_t)dec->nextIn;
+    dec->bz.avail_in = have ? ((dec->availIn > DECODER_MAX_FEED) ? DECODER_MAX_FEED : (unsigned int)dec->availIn) : 0;
+    before = dec->bz.avail_out;
+    ret = BZ2_bzDecompress(&dec->bz);
+    dec->availIn -= (size_t)((const unsigned char *)dec->bz.next_in - dec->nextIn);
+    dec->nextIn = (const unsigned char *)dec->bz.next_in;
+
+    if (ret == BZ_STREAM_END)
+      dec->streamEnd = TRUE;
+    else if (ret != BZ_OK)
+    {
+      fprintf(stderr, "ERR - Corrupt bzip2 input (error %d)\n", ret);
+      return -1;
+    }
+    else if (!have && (dec->bz.avail_out == before))
+      break;
+  }
+
+  return (ssize_t)(outSize - dec->bz.avail_out);
+}
+#endif
+
+/****
+ *
+ * fill out with decompressed data, 0 at the end of input and -1 on error
+ *
+ ****/
+
+PRIVATE ssize_t decodeBlock(decoder_t *dec, char *out, size_t outSize)
+{
+  ssize_t produced = -1;
+
+  if (dec->finished)
+    return 0;
+
+  switch (dec->format)
+  {
+#ifdef HAVE_GZIP_DECODER
+  case COMPRESS_GZIP:
+    produced = decodeGzip(dec, out, outSize);
+    break;
+#endif
+#ifdef HAVE_ZSTD_DECODER
+  case COMPRESS_ZSTD:
+    produced = decodeZstd(dec, out, outSize);
+    break;
+#endif
+#ifdef HAVE_XZ_DECODER
+  case COMPRESS_XZ:
+    produced = decodeXz(dec, out, outSize);
+    break;
+#endif
+#ifdef HAVE_BZIP2_DECODER
+  case COMPRESS_BZIP2:
+    produced = decodeBzip2(dec, out, outSize);
+    break;
+#endif
+  }
+
+  if (produced <= 0)
+  {
+    dec->finished = TRUE;
+    if ((produced == 0) && !dec->streamEnd)
+      fprintf(stderr, "ERR - Unexpected end of %s input\n", compressionName(dec->format));
+  }
+
+  return produced;
+}
+
+#ifdef HAVE_PTHREAD_H
+/****
+ *
+ * decompression thread, keeps up to DECODER_BLOCKS blocks ahead of the parser
+ *
+ ****/
+
+PRIVATE void *decoderMain(void *arg)
+{
+  decoder_t *dec = (decoder_t *)arg;
+  sigset_t sigSet;
+  ssize_t produced;
+  int slot;
+
+  /* leave the stats alarm to the reader thread */
+  sigemptyset(&sigSet);
+  sigaddset(&sigSet, SIGALRM);
+  pthread_sigmask(SIG_BLOCK, &sigSet, NULL);
+
+  for (;;)
+  {
+    pthread_mutex_lock(&dec->lock);
+    while ((dec->count == DECODER_BLOCKS) && !dec->cancel)
+      pthread_cond_wait(&dec->notFull, &dec->lock);
+    if (dec->cancel)
+    {
+      pthread_mutex_unlock(&dec->lock);
+      break;
+    }
+    slot = (dec->head + dec->count) % DECODER_BLOCKS;
+    pthread_mutex_unlock(&dec->lock);
+
+    /* the slot is not visible to the reader until count covers it */
+    produced = decodeBlock(dec, dec->blocks[slot].buf, DECODER_BLOCK_SIZE);
+
+    pthread_mutex_lock(&dec->lock);
+    if (produced > 0)
+    {
+      dec->blocks[slot].len = (size_t)produced;
+      dec->count++;
+    }
+    else
+    {
+      dec->done = TRUE;
+      dec->error = (produced < 0);
+    }
+    pthread_cond_signal(&dec->notEmpty);
+    pthread_mutex_unlock(&dec->lock);
+
+    if (produced <= 0)
+      break;
+  }
+
+  return NULL;
+}
+#endif
+
+/****
+ *
+ * set up a decoder
+ *
+ * data holds input already read from fd (or all of it when fd is -1,
+ * as for a mapped file). with pthreads the decoding runs on its own
+ * thread so it overlaps with parsing
+ *
+ ****/
+
+decoder_t *initDecoder(int format, int fd, char *data, size_t dataLen)
+{
+  decoder_t *dec;
+  int ret = FAILED;
+#ifdef HAVE_PTHREAD_H
+  int i;
+#endif
+
+  dec = (decoder_t *)XMALLOC(sizeof(decoder_t));
+  XMEMSET(dec, 0, sizeof(decoder_t));
+  dec->format = format;
+  dec->fd = fd;
+
+  if (fd == -1)
+  {
+    dec->nextIn = (const unsigned char *)data;
+    dec->availIn = dataLen;
+  }
+  else
+  {
+    dec->inBufSize = (dataLen > DECODER_IN_SIZE) ? dataLen : DECODER_IN_SIZE;
+    dec->inBuf = (unsigned char *)XMALLOC(dec->inBufSize);
+    if (dataLen > 0)
+      XMEMCPY(dec->inBuf, data, dataLen);
+    dec->nextIn = dec->inBuf;
+    dec->availIn = dataLen;
+  }
+
+  switch (format)
+  {
+#ifdef HAVE_GZIP_DECODER
+  case COMPRESS_GZIP:
+    /* 15 + 32 accepts gzip and zlib headers */
+    if (inflateInit2(&dec->gz, 15 + 32) == Z_OK)
+      ret = TRUE;
+    break;
+#endif
+#ifdef HAVE_ZSTD_DECODER
+  case COMPRESS_ZSTD:
+    if ((dec->zs = ZSTD_createDStream()) != NULL)
+      ret = TRUE;
+    break;
+#endif
+#ifdef HAVE_XZ_DECODER
+  case COMPRESS_XZ:
+    dec->xz = (lzma_stream)LZMA_STREAM_INIT;
+    if (lzma_stream_decoder(&dec->xz, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK)
+      ret = TRUE;
+    break;
+#endif
+#ifdef HAVE_BZIP2_DECODER
+  case COMPRESS_BZIP2:
+    if (BZ2_bzDecompressInit(&dec->bz, 0, 0) == BZ_OK)
+      ret = TRUE;
+    break;
+#endif
+  }
+
+  if (ret != TRUE)
+  {
+    fprintf(stderr, "ERR - Unable to initialize %s decoder\n", compressionName(format));
+    if (dec->inBuf != NULL)
+      XFREE(dec->inBuf);
+    XFREE(dec);
+    return NULL;
+  }
+
+#ifdef DEBUG
+  if (config->debug >= 2)
+    fprintf(stderr, "DEBUG - Reading %s compressed input\n", compressionName(format));
+#endif
+
+#ifdef HAVE_PTHREAD_H
+  for (i = 0; i < DECODER_BLOCKS; i++)
+    dec->blocks[i].buf = (char *)XMALLOC(DECODER_BLOCK_SIZE);
+  pthread_mutex_init(&dec->lock, NULL);
+  pthread_cond_init(&dec->notEmpty, NULL);
+  pthread_cond_init(&dec->notFull, NULL);
+  if (pthread_create(&dec->thread, NULL, decoderMain, dec) == 0)
+    dec->threaded = TRUE;
+  else
+    fprintf(stderr, "ERR - Unable to start decompression thread, decompressing inline\n");
+#endif
+
+  return dec;
+}
+
+/****
+ *
+ * read decompressed data, 0 at the end of input and -1 on error
+ *
+ ****/
+
+ssize_t readDecoder(decoder_t *dec, char *out, size_t outSize)
+{
+#ifdef HAVE_PTHREAD_H
+  struct decodedBlock_s *block;
+  size_t len;
+
+  if (dec->threaded)
+  {
+    pthread_mutex_lock(&dec->lock);
+    while ((dec->count == 0) && !dec->done)
+      pthread_cond_wait(&dec->notEmpty, &dec->lock);
+    if (dec->count == 0)
+    {
+      pthread_mutex_unlock(&dec->lock);
+      return dec->error ? -1 : 0;
+    }
+    block = &dec->blocks[dec->head];
+    pthread_mutex_unlock(&dec->lock);
+
+    /* the head block belongs to the reader until it is released */
+    len = block->len - dec->readPos;
+    if (len > outSize)
+      len = outSize;
+    XMEMCPY(out, block->buf + dec->readPos, len);
+    dec->readPos += len;
+
+    if (dec->readPos == block->len)
+    {
+      pthread_mutex_lock(&dec->lock);
+      dec->head = (dec->head + 1) % DECODER_BLOCKS;
+      dec->count--;
+      dec->readPos = 0;
+      pthread_cond_signal(&dec->notFull);
+      pthread_mutex_unlock(&dec->lock);
+    }
+
+    return (ssize_t)len;
+  }
+#endif
+
+  return decodeBlock(dec, out, outSize);
+}
+
+/****
+ *
+ * stop the decoder and free it
+ *
+ ****/
+
+void deInitDecoder(decoder_t *dec)
+{
+#ifdef HAVE_PTHREAD_H
+  int i;
+#endif
+
+  if (dec == NULL)
+    return;
+
+#ifdef HAVE_PTHREAD_H
+  if (dec->threaded)
+  {
+    pthread_mutex_lock(&dec->lock);
+    dec->cancel = TRUE;
+    pthread_cond_broadcast(&dec->notFull);
+    pthread_mutex_unlock(&dec->lock);
+    pthread_join(dec->thread, NULL);
+  }
+  pthread_cond_destroy(&dec->notFull);
+  pthread_cond_destroy(&dec->notEmpty);
+  pthread_mutex_destroy(&dec->lock);
+  for (i = 0; i < DECODER_BLOCKS; i++)
+    XFREE(dec->blocks[i].buf);
+#endif
+
+  switch (dec->format)
+  {
+#ifdef HAVE_GZIP_DECODER
+  case COMPRESS_GZIP:
+    inflateEnd(&dec->gz);
+    break;
+#endif
+#ifdef HAVE_ZSTD_DECODER
+  case COMPRESS_ZSTD:
+    ZSTD_freeDStream(dec->zs);
+    break;
+#endif
+#ifdef HAVE_XZ_DECODER
+  case COMPRESS_XZ:
+    lzma_end(&dec->xz);
+    break;
+#endif
+#ifdef HAVE_BZIP2_DECODER
+  case COMPRESS_BZIP2:
+    BZ2_bzDecompressEnd(&dec->bz);
+    break;
+#endif
+  }
+
+  if (dec->inBuf != NULL)
+    XFREE(dec->inBuf);
+  XFREE(dec);
+}
@@ -0,0 +1,86 @@
+/*****
+ *
+ * Description: Compressed Input Decoder Headers
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#ifndef DECOMPRESS_DOT_H
+#define DECOMPRESS_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+#include "mem.h"
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+#define COMPRESS_NONE 0
+#define COMPRESS_GZIP 1
+#define COMPRESS_ZSTD 2
+#define COMPRESS_XZ 3
+#define COMPRESS_BZIP2 4
+
+/* bytes needed to recognize every supported format */
+#define COMPRESS_MAGIC_LEN 6
+
+#define DECODER_IN_SIZE (128 * 1024)       /* compressed read size */
+#define DECODER_BLOCK_SIZE (256 * 1024)    /* decompressed block size */
+#define DECODER_BLOCKS 4                   /* blocks buffered ahead of the reader */
+#define DECODER_MAX_FEED 0x40000000        /* most input handed to a decoder call */
+
+/****
+ *
+ * typedefs & structs
+ *
+ ****/
+
+typedef struct decoder_s decoder_t;
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+int detectCompression(const unsigned char *buf, size_t len);
+const char *compressionName(int format);
+int compressionSupported(int format);
+decoder_t *initDecoder(int format, int fd, char *data, size_t dataLen);
+ssize_t readDecoder(decoder_t *dec, char *out, size_t outSize);
+void deInitDecoder(decoder_t *dec);
+
+#endif /* DECOMPRESS_DOT_H */
@@ -0,0 +1,447 @@
+/*****
+ *
+ * Description: Follow Mode Functions
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "follow.h"
+
+/****
+ *
+ * local variables
+ *
+ ****/
+
+PRIVATE ParserInterface *followParser = NULL;
+PRIVATE parser_ctx_t *followCtx = NULL;
+PRIVATE unsigned int followLineCount = 0;
+
+/****
+ *
+ * external variables
+ *
+ ****/
+
+extern Config_t *config;
+extern int quit;
+extern int reload;
+extern struct hash_s *templateHash;
+extern output_t *reportOut;
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * (re)open a followed file from the start
+ *
+ ****/
+
+PRIVATE int openFollowFile(struct followFile_s *ff)
+{
+  struct stat st;
+
+  if ((ff->fd = open(ff->fName, O_RDONLY | O_NOFOLLOW)) == -1)
+  {
+    if (!ff->reported)
+    {
+      if (errno == ELOOP)
+        fprintf(stderr, "ERR - Symbolic link detected, access denied: %s\n", ff->fName);
+      else
+        fprintf(stderr, "ERR - Unable to open file [%s] %d (%s), waiting for it\n", ff->fName, errno, strerror(errno));
+      ff->reported = TRUE;
+    }
+    return FALSE;
+  }
+
+  if (fstat(ff->fd, &st) == 0)
+  {
+    ff->dev = st.st_dev;
+    ff->ino = st.st_ino;
+  }
+  ff->pos = 0;
+  ff->bufLen = 0;
+  ff->reported = FALSE;
+
+#ifdef DEBUG
+  if (config->debug >= 1)
+    fprintf(stderr, "DEBUG - Following [%s]\n", ff->fName);
+#endif
+
+  return TRUE;
+}
+
+/****
+ *
+ * template one line, print it when its template is new
+ *
+ ****/
+
+PRIVATE void followLine(char *line, size_t len, int report)
+{
+  parser_field_t field;
+  int ret;
+
+  if (reload == TRUE)
+  {
+    fprintf(stderr, "Processed %d lines/min\n", followLineCount);
+    followLineCount = 0;
+    reload = FALSE;
+  }
+
+  if ((ret = followParser->parseLine(followCtx, line, (int)len)) <= 0)
+    return;
+  followLineCount++;
+
+  if (config->match)
+  {
+    getParserField(followParser, followCtx, 0, &field);
+    if (report && templateMatches(field.ptr, field.len, field.hash))
+    {
+      writeOutput(reportOut, line, len);
+      if (line[len - 1] != '\n')
+        writeOutput(reportOut, "\n", 1);
+    }
+  }
+  else if ((storeTemplate(followParser, followCtx, ret, line, len) == TRUE) && report)
+  {
+    getParserField(followParser, followCtx, 0, &field);
+    writeOutput(reportOut, field.ptr, field.len);
+    writeOutput(reportOut, "||", 2);
+    writeOutput(reportOut, line, len);
+    if (line[len - 1] != '\n')
+      writeOutput(reportOut, "\n", 1);
+  }
+}
+
+/****
+ *
+ * hand complete lines in the buffer to followLine(), keep the rest
+ *
+ ****/
+
+PRIVATE void splitFollowLines(struct followFile_s *ff, int report, int flush)
+{
+  char *start = ff->buf, *nl;
+  size_t avail = ff->bufLen, len;
+
+  while (avail > 0)
+  {
+    /* split lines exactly as readInputLine() does */
+    if ((nl = memchr(start, '\n', (avail < INPUT_MAX_LINE) ? avail : INPUT_MAX_LINE)) != NULL)
+      len = (size_t)(nl - start) + 1;
+    else if ((avail >= INPUT_MAX_LINE) || flush)
+      len = (avail < INPUT_MAX_LINE) ? avail : INPUT_MAX_LINE;
+    else
+      break; /* wait for the rest of the line */
+
+    followLine(start, len, report);
+    start += len;
+    avail -= len;
+  }
+
+  if ((avail > 0) && (start != ff->buf))
+    memmove(ff->buf, start, avail);
+  ff->bufLen = avail;
+}
+
+/****
+ *
+ * read whatever has been appended to a file
+ *
+ * regular files are read to the current end, a pipe gets a single
+ * read so the caller never blocks. returns FALSE at the end of a pipe
+ *
+ ****/
+
+PRIVATE int drainFollowFile(struct followFile_s *ff, int report)
+{
+  ssize_t rCount;
+
+  if (ff->fd == -1)
+    return TRUE;
+
+  for (;;)
+  {
+    rCount = read(ff->fd, ff->buf + ff->bufLen, FOLLOW_READ_SIZE - ff->bufLen);
+    if ((rCount == -1) && (errno == EINTR) && !quit)
+      continue;
+    if (rCount <= 0)
+    {
+      if (rCount == -1)
+        fprintf(stderr, "ERR - Read failed [%s] %d (%s)\n", ff->fName, errno, strerror(errno));
+      return ((rCount == 0) && ff->isStdin) ? FALSE : TRUE;
+    }
+
+    ff->pos += rCount;
+    ff->bufLen += (size_t)rCount;
+    splitFollowLines(ff, report, FALSE);
+
+    if (ff->isStdin || quit)
+      return TRUE;
+  }
+}
+
+/****
+ *
+ * notice a rotated or truncated file
+ *
+ * a rename away is picked up once a new file appears under the old
+ * name, whatever was left in the old file has been read by then
+ *
+ ****/
+
+PRIVATE void checkFollowFile(struct followFile_s *ff)
+{
+  struct stat st;
+
+  if (ff->isStdin)
+    return;
+
+  if (ff->fd == -1)
+  { /* file was missing, it is all new when it shows up */
+    if (openFollowFile(ff))
+      drainFollowFile(ff, TRUE);
+    return;
+  }
+
+  if ((stat(ff->fName, &st) == 0) && ((st.st_ino != ff->ino) || (st.st_dev != ff->dev)))
+  {
+#ifdef DEBUG
+    if (config->debug >= 1)
+      fprintf(stderr, "DEBUG - [%s] was rotated, reopening\n", ff->fName);
+#endif
+    drainFollowFile(ff, TRUE);
+    splitFollowLines(ff, TRUE, TRUE);
+    close(ff->fd);
+    if (openFollowFile(ff))
+      drainFollowFile(ff, TRUE);
+  }
+  else if ((fstat(ff->fd, &st) == 0) && (st.st_size < ff->pos))
+  {
+#ifdef DEBUG
+    if (config->debug >= 1)
+      fprintf(stderr, "DEBUG - [%s] was truncated, rereading\n", ff->fName);
+#endif
+    lseek(ff->fd, 0, SEEK_SET);
+    ff->pos = 0;
+    ff->bufLen = 0;
+    drainFollowFile(ff, TRUE);
+  }
+}
+
+#ifdef HAVE_INOTIFY_INIT1
+/****
+ *
+ * watch the directory of each followed file
+ *
+ * directory events cover appends, creates and renames so rotation
+ * wakes us without watching each inode
+ *
+ ****/
+
+PRIVATE int initFollowWatch(struct followFile_s *files, int fCount)
+{
+  char dirName[PATH_MAX];
+  const char *slash;
+  int i, iFd;
+
+  if ((iFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1)
+  {
+    fprintf(stderr, "ERR - Unable to start inotify %d (%s), polling instead\n", errno, strerror(errno));
+    return -1;
+  }
+
+  for (i = 0; i < fCount; i++)
+  {
+    if (files[i].isStdin)
+      continue;
+
+    if ((slash = strrchr(files[i].fName, '/')) == NULL)
+      XSTRNCPY(dirName, ".", sizeof(dirName));
+    else if (slash == files[i].fName)
+      XSTRNCPY(dirName, "/", sizeof(dirName));
+    else
+      snprintf(dirName, sizeof(dirName), "%.*s", (int)(slash - files[i].fName), files[i].fName);
+
+    if (inotify_add_watch(iFd, dirName, IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ATTRIB) == -1)
+      fprintf(stderr, "ERR - Unable to watch [%s] %d (%s), polling it\n", dirName, errno, strerror(errno));
+  }
+
+  return iFd;
+}
+#endif
+
+/****
+ *
+ * follow files as they grow
+ *
+ * existing contents are read first to learn the known templates,
+ * after that every line that produces a new template is printed as
+ * soon as it is read
+ *
+ ****/
+
+int followFiles(char *fNames[], int fCount)
+{
+  struct followFile_s *files;
+  int i, active, ret = EXIT_SUCCESS;
+#ifdef HAVE_POLL_H
+  struct pollfd pfd[2];
+  int nfds, stdinIdx = -1;
+  char evBuf[4096];
+#endif
+  int iFd = -1, stdinFile = -1;
+
+  if (templateHash == NULL)
+    templateHash = initSwissHash(config->cluster ? 12289 : 389);
+
+  if ((followParser = getParser((ParserType)config->parser_type)) == NULL)
+  {
+    fprintf(stderr, "ERR - Unable to get parser interface\n");
+    return (EXIT_FAILURE);
+  }
+  if ((followCtx = followParser->init()) == NULL)
+    return (EXIT_FAILURE);
+
+  files = (struct followFile_s *)XMALLOC(sizeof(struct followFile_s) * fCount);
+  XMEMSET(files, 0, sizeof(struct followFile_s) * fCount);
+
+  for (i = 0; i < fCount; i++)
+  {
+    files[i].fName = fNames[i];
+    files[i].buf = (char *)XMALLOC(FOLLOW_READ_SIZE);
+    if (strcmp(fNames[i], "-") == 0)
+    {
+      if (stdinFile != -1)
+      {
+        fprintf(stderr, "ERR - stdin can only be followed once\n");
+        files[i].fd = -1;
+        files[i].isStdin = TRUE;
+        continue;
+      }
+      files[i].fd = STDIN_FILENO;
+      files[i].isStdin = TRUE;
+      stdinFile = i;
+    }
+    else if (openFollowFile(&files[i]))
+      drainFollowFile(&files[i], FALSE);
+  }
+
+#ifdef HAVE_INOTIFY_INIT1
+  iFd = initFollowWatch(files, fCount);
+#endif
+
+  flushOutput(reportOut);
+
+  while (!quit)
+  {
+#ifdef HAVE_POLL_H
+    nfds = 0;
+    if (iFd != -1)
+    {
+      pfd[nfds].fd = iFd;
+      pfd[nfds++].events = POLLIN;
+    }
+    stdinIdx = -1;
+    if ((stdinFile != -1) && (files[stdinFile].fd != -1))
+    {
+      stdinIdx = nfds;
+      pfd[nfds].fd = STDIN_FILENO;
+      pfd[nfds++].events = POLLIN;
+    }
+
+    if (poll(pfd, nfds, FOLLOW_POLL_MS) == -1)
+    {
+      if (errno == EINTR)
+        continue;
+      fprintf(stderr, "ERR - poll failed %d (%s)\n", errno, strerror(errno));
+      ret = EXIT_FAILURE;
+      break;
+    }
+
+    /* the events only wake us up, every file gets checked below */
+    if (iFd != -1)
+      while (read(iFd, evBuf, sizeof(evBuf)) > 0)
+        ;
+
+    if ((stdinIdx != -1) && (pfd[stdinIdx].revents & (POLLIN | POLLHUP | POLLERR)))
+    {
+      if (!drainFollowFile(&files[stdinFile], TRUE))
+      { /* end of the pipe, finish the last line */
+        splitFollowLines(&files[stdinFile], TRUE, TRUE);
+        files[stdinFile].fd = -1;
+      }
+    }
+#else
+    /* without poll() a followed pipe is read blocking */
+    if ((stdinFile != -1) && (files[stdinFile].fd != -1) && !drainFollowFile(&files[stdinFile], TRUE))
+    {
+      splitFollowLines(&files[stdinFile], TRUE, TRUE);
+      files[stdinFile].fd = -1;
+    }
+    sleep(FOLLOW_POLL_MS / 1000);
+#endif
+
+    for (i = 0, active = 0; (i < fCount) && !quit; i++)
+    {
+      if (files[i].isStdin)
+      {
+        active += (files[i].fd != -1);
+        continue;
+      }
+      active++;
+      drainFollowFile(&files[i], TRUE);
+      checkFollowFile(&files[i]);
+    }
+
+    flushOutput(reportOut);
+
+    /* nothing left that can grow */
+    if (active == 0)
+      break;
+  }
+
+  /* cleanup */
+#ifdef HAVE_INOTIFY_INIT1
+  if (iFd != -1)
+    close(iFd);
+#endif
+  for (i = 0; i < fCount; i++)
+  {
+    if ((files[i].fd != -1) && !files[i].isStdin)
+      close(files[i].fd);
+    XFREE(files[i].buf);
+  }
+  XFREE(files);
+
+  followParser->deinit(followCtx);
+  followCtx = NULL;
+
+  return (ret);
+}
@@ -0,0 +1,82 @@
+/*****
+ *
+ * Description: Follow Mode Headers
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#ifndef FOLLOW_DOT_H
+#define FOLLOW_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+#include "tmpltr.h"
+#include "input.h"
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+#define FOLLOW_POLL_MS 1000                /* rescan interval, the only wakeup without inotify */
+#define FOLLOW_READ_SIZE (256 * 1024)      /* must be larger than INPUT_MAX_LINE */
+
+/****
+ *
+ * typedefs & structs
+ *
+ ****/
+
+struct followFile_s
+{
+  const char *fName;
+  int fd;                                  /* -1 while the file is missing */
+  int isStdin;
+  int reported;                            /* open error already shown */
+  dev_t dev;
+  ino_t ino;
+  off_t pos;
+  char *buf;                               /* partial line waiting for its newline */
+  size_t bufLen;
+};
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+int followFiles(char *fNames[], int fCount);
+
+#endif /* FOLLOW_DOT_H */
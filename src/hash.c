@@ -29,6 +29,9 @@
 #include "hash.h"
 #include "mem.h"
 #include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 /****
  *
@@ -44,10 +47,6 @@ static size_t hashPrimes[] = {
     100663319, 201326611, 402653189, 805306457, 1610612741, 0
 };
 
-/* FNV-1a hash constants */
-#define FNV_OFFSET_BASIS 2166136261U
-#define FNV_PRIME 16777619U
-
 /* Memory pool constants */
 #define POOL_SIZE 1024
 
@@ -114,21 +113,375 @@ static void freePools(struct hash_s *hash)
 
 /****
  *
- * FNV-1a hash function
+ * Key arena
+ *
+ * keys are bump allocated into large blocks owned by the hash, there
+ * is no per key malloc header and records point into the blocks for
+ * the life of the hash, growth never touches them
  *
  ****/
 
-uint32_t fnv1aHash(const char *keyString, int keyLen)
+static char *allocHashKey(struct hash_s *hash, int keyLen)
 {
-  uint32_t hash = FNV_OFFSET_BASIS;
+  struct hashKeyBlock_s *block = hash->keyBlocks;
+  size_t size;
+  char *key;
+
+  if ((block == NULL) || (block->used + (size_t)keyLen > block->size)) {
+    size = ((size_t)keyLen > KEY_BLOCK_SIZE) ? (size_t)keyLen : KEY_BLOCK_SIZE;
+    if ((block = (struct hashKeyBlock_s *)XMALLOC(sizeof(struct hashKeyBlock_s) + size)) == NULL)
+      return NULL;
+    block->size = size;
+    block->used = 0;
+    if ((size > KEY_BLOCK_SIZE) && (hash->keyBlocks != NULL)) {
+      /* an oversized key fills its block, keep filling the current one */
+      block->next = hash->keyBlocks->next;
+      hash->keyBlocks->next = block;
+    } else {
+      block->next = hash->keyBlocks;
+      hash->keyBlocks = block;
+    }
+  }
+
+  key = block->keys + block->used;
+  block->used += (size_t)keyLen;
+  return key;
+}
+
+static void freeKeyBlocks(struct hash_s *hash)
+{
+  struct hashKeyBlock_s *block = hash->keyBlocks;
+  struct hashKeyBlock_s *next;
+
+  while (block) {
+    next = block->next;
+    XFREE(block);
+    block = next;
+  }
+  hash->keyBlocks = NULL;
+}
+
+/****
+ *
+ * Swiss table helpers
+ *
+ * the table is a power of two array of record pointers with a parallel
+ * array of control bytes.  a free slot holds SWISS_EMPTY, a full slot
+ * holds the top 7 bits of the record hash.  lookups pick a 16 slot
+ * group from the low hash bits and compare all 16 control bytes at
+ * once, only slots whose tag matches are dereferenced.  groups are
+ * probed triangularly, which visits every group of a power of two
+ * table.  records never move once allocated, so pointers handed out
+ * stay valid across growth.
+ *
+ * growing allocates the larger index and keeps the old one around,
+ * each insert then moves SWISS_MIGRATE_STEP old slots across.  the
+ * old index is never modified, lookups that miss the new index fall
+ * back to it until the migration is done.  a full rehash never runs
+ * inside the line loop, so per line latency stays flat as the table
+ * grows.
+ *
+ ****/
+
+#define SWISS_TAG(h) ((uint8_t)((h) >> 57))
+
+PRIVATE inline uint32_t swissMatch(const uint8_t *group, uint8_t tag)
+{
+#ifdef __SSE2__
+  __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+  return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)tag)));
+#else
+  uint32_t mask = 0;
   int i;
-  
-  for (i = 0; i < keyLen; i++) {
-    hash ^= (uint8_t)keyString[i];
-    hash *= FNV_PRIME;
+
+  for (i = 0; i < SWISS_GROUP; i++)
+    if (group[i] == tag)
+      mask |= 1U << i;
+  return mask;
+#endif
+}
+
+PRIVATE inline uint32_t swissMatchEmpty(const uint8_t *group)
+{
+#ifdef __SSE2__
+  /* only empty slots have the high bit set */
+  return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+  return swissMatch(group, SWISS_EMPTY);
+#endif
+}
+
+PRIVATE struct hashRec_s *swissProbe(const uint8_t *ctrlBase, struct hashRec_s *const *slots, uint32_t groupMask,
+                                     const char *keyString, int keyLen, uint64_t hashValue)
+{
+  uint32_t group = (uint32_t)hashValue & groupMask;
+  uint32_t step = 0, mask, slot;
+  uint8_t tag = SWISS_TAG(hashValue);
+  const uint8_t *ctrl;
+  struct hashRec_s *record;
+
+  for (;;)
+  {
+    ctrl = ctrlBase + (group * SWISS_GROUP);
+    for (mask = swissMatch(ctrl, tag); mask; mask &= mask - 1)
+    {
+      slot = (group * SWISS_GROUP) + __builtin_ctz(mask);
+      record = slots[slot];
+      if (record->hashValue == hashValue &&
+          record->keyLen == keyLen &&
+          XMEMCMP(record->keyString, keyString, keyLen) == 0)
+        return record;
+    }
+    /* no deletes, so a group with a free slot ends the probe */
+    if (swissMatchEmpty(ctrl))
+      return NULL;
+    step++;
+    group = (group + step) & groupMask;
   }
-  
-  return hash;
+}
+
+PRIVATE struct hashRec_s *swissFind(const struct hash_s *hash, const char *keyString, int keyLen, uint64_t hashValue)
+{
+  struct hashRec_s *record;
+
+  record = swissProbe(hash->ctrl, hash->slots, hash->groupMask, keyString, keyLen, hashValue);
+  /* records that have not moved yet are still reachable through the old index */
+  if ((record == NULL) && (hash->oldCtrl != NULL))
+    record = swissProbe(hash->oldCtrl, hash->oldSlots, hash->oldGroupMask, keyString, keyLen, hashValue);
+  return record;
+}
+
+PRIVATE uint16_t swissPlace(struct hash_s *hash, struct hashRec_s *record)
+{
+  uint32_t group = (uint32_t)record->hashValue & hash->groupMask;
+  uint32_t step = 0, mask, slot;
+
+  for (;;)
+  {
+    if ((mask = swissMatchEmpty(hash->ctrl + (group * SWISS_GROUP))) != 0)
+    {
+      slot = (group * SWISS_GROUP) + __builtin_ctz(mask);
+      hash->ctrl[slot] = SWISS_TAG(record->hashValue);
+      hash->slots[slot] = record;
+      return (step > UINT16_MAX) ? UINT16_MAX : (uint16_t)step;
+    }
+    step++;
+    group = (group + step) & hash->groupMask;
+  }
+}
+
+PRIVATE int swissAlloc(struct hash_s *hash, uint32_t capacity)
+{
+  if ((hash->ctrl = (uint8_t *)XMALLOC(capacity)) == NULL)
+    return FAILED;
+  if ((hash->slots = (struct hashRec_s **)XMALLOC(sizeof(struct hashRec_s *) * capacity)) == NULL)
+  {
+    XFREE(hash->ctrl);
+    hash->ctrl = NULL;
+    return FAILED;
+  }
+  XMEMSET(hash->ctrl, SWISS_EMPTY, capacity);
+  hash->size = capacity;
+  hash->groupMask = (capacity / SWISS_GROUP) - 1;
+  hash->maxDepth = 0;
+  return TRUE;
+}
+
+/****
+ *
+ * move up to count old slots into the new index
+ *
+ ****/
+
+PRIVATE void swissMigrate(struct hash_s *hash, uint32_t count)
+{
+  uint32_t i, end;
+  uint16_t depth;
+
+  end = (count < hash->oldSize - hash->migratePos) ? hash->migratePos + count : hash->oldSize;
+  for (i = hash->migratePos; i < end; i++)
+    if (!(hash->oldCtrl[i] & SWISS_EMPTY))
+    {
+      depth = swissPlace(hash, hash->oldSlots[i]);
+      if (depth > hash->maxDepth)
+        hash->maxDepth = depth;
+    }
+  hash->migratePos = end;
+
+  if (end == hash->oldSize)
+  {
+    XFREE(hash->oldCtrl);
+    XFREE(hash->oldSlots);
+    hash->oldCtrl = NULL;
+    hash->oldSlots = NULL;
+    hash->oldSize = hash->oldGroupMask = hash->migratePos = 0;
+#ifdef DEBUG
+    if (config->debug >= 3)
+      printf("DEBUG - Hash migration to %u slots complete\n", hash->size);
+#endif
+  }
+}
+
+/****
+ *
+ * start growing into a larger index, records migrate on later inserts
+ *
+ ****/
+
+PRIVATE int swissResize(struct hash_s *hash, uint32_t capacity)
+{
+  uint8_t *oldCtrl;
+  struct hashRec_s **oldSlots;
+  uint32_t oldSize, oldGroupMask;
+
+  /* only one old index at a time */
+  if (hash->oldCtrl != NULL)
+    swissMigrate(hash, hash->oldSize);
+
+  oldCtrl = hash->ctrl;
+  oldSlots = hash->slots;
+  oldSize = hash->size;
+  oldGroupMask = hash->groupMask;
+
+  if (swissAlloc(hash, capacity) != TRUE)
+  {
+    hash->ctrl = oldCtrl;
+    hash->slots = oldSlots;
+    fprintf(stderr, "ERR - Unable to allocate new hash\n");
+    return FAILED;
+  }
+
+  hash->oldCtrl = oldCtrl;
+  hash->oldSlots = oldSlots;
+  hash->oldSize = oldSize;
+  hash->oldGroupMask = oldGroupMask;
+  hash->migratePos = 0;
+
+#ifdef DEBUG
+  if (config->debug >= 2)
+    printf("DEBUG - Growing hash from %u to %u slots\n", oldSize, hash->size);
+#endif
+
+  return TRUE;
+}
+
+/****
+ *
+ * 64 bit key hash
+ *
+ * a wyhash (Wang Yi, public domain) style hash.  keys are read 16 or
+ * 48 bytes per round and every round is one 64x64->128 bit multiply
+ * with its halves folded together, so long templates cost a few
+ * multiplies instead of one per byte.  the low bits index the tables
+ * and the top 7 bits are the swiss control tag.  the value depends on
+ * the host byte order.  binary template databases (templatedb.c) store
+ * these values on disk, their header records hashKey() of the magic
+ * and the byte order so a file written with a different hash or byte
+ * order is rejected instead of silently missing every lookup.
+ *
+ ****/
+
+#define HASH_SECRET0 0x2d358dccaa6c78a5ULL
+#define HASH_SECRET1 0x8bb84b93962eacc9ULL
+#define HASH_SECRET2 0x4b33a62ed433d4a3ULL
+#define HASH_SECRET3 0x4d5a2da51de1aa47ULL
+
+PRIVATE inline void hashMultiply(uint64_t *a, uint64_t *b)
+{
+#ifdef __SIZEOF_INT128__
+  __uint128_t r = (__uint128_t)*a * *b;
+
+  *a = (uint64_t)r;
+  *b = (uint64_t)(r >> 64);
+#else
+  uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32), lo, c = (t < rl);
+
+  lo = t + (rm1 << 32);
+  c += (lo < t);
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+PRIVATE inline uint64_t hashMix(uint64_t a, uint64_t b)
+{
+  hashMultiply(&a, &b);
+  return a ^ b;
+}
+
+PRIVATE inline uint64_t hashRead8(const uint8_t *p)
+{
+  uint64_t v;
+
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+PRIVATE inline uint64_t hashRead4(const uint8_t *p)
+{
+  uint32_t v;
+
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+uint64_t hashKey(const char *keyString, int keyLen)
+{
+  const uint8_t *p = (const uint8_t *)keyString;
+  size_t len = (keyLen > 0) ? (size_t)keyLen : 0;
+  size_t i = len;
+  uint64_t seed = hashMix(HASH_SECRET0, HASH_SECRET1);
+  uint64_t a, b, seed1, seed2;
+
+  if (len <= 16)
+  {
+    if (len >= 4)
+    {
+      /* two overlapping reads from each end cover 4 to 16 bytes */
+      a = (hashRead4(p) << 32) | hashRead4(p + ((len >> 3) << 2));
+      b = (hashRead4(p + len - 4) << 32) | hashRead4(p + len - 4 - ((len >> 3) << 2));
+    }
+    else if (len > 0)
+    {
+      a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+      b = 0;
+    }
+    else
+      a = b = 0;
+  }
+  else
+  {
+    if (i > 48)
+    {
+      /* three independent lanes keep the multipliers busy */
+      seed1 = seed2 = seed;
+      do
+      {
+        seed = hashMix(hashRead8(p) ^ HASH_SECRET1, hashRead8(p + 8) ^ seed);
+        seed1 = hashMix(hashRead8(p + 16) ^ HASH_SECRET2, hashRead8(p + 24) ^ seed1);
+        seed2 = hashMix(hashRead8(p + 32) ^ HASH_SECRET3, hashRead8(p + 40) ^ seed2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= seed1 ^ seed2;
+    }
+    while (i > 16)
+    {
+      seed = hashMix(hashRead8(p) ^ HASH_SECRET1, hashRead8(p + 8) ^ seed);
+      p += 16;
+      i -= 16;
+    }
+    /* the last 16 bytes, overlapping the previous round if need be */
+    a = hashRead8(p + i - 16);
+    b = hashRead8(p + i - 8);
+  }
+
+  a ^= HASH_SECRET1;
+  b ^= seed;
+  hashMultiply(&a, &b);
+  return hashMix(a ^ HASH_SECRET0 ^ len, b ^ HASH_SECRET1);
 }
 
 /****
@@ -182,6 +535,43 @@ struct hash_s *initHash(uint32_t hashSize)
   return tmpHash;
 }
 
+/****
+ *
+ * Initialize open addressing (swiss) hash table
+ *
+ * same api as the chained table, size is the slot count rounded up
+ * to a power of two
+ *
+ ****/
+
+struct hash_s *initSwissHash(uint32_t hashSize)
+{
+  struct hash_s *tmpHash;
+  uint32_t capacity = SWISS_MIN_SIZE;
+
+  if ((tmpHash = (struct hash_s *)XMALLOC(sizeof(struct hash_s))) == NULL) {
+    fprintf(stderr, "ERR - Unable to allocate hash\n");
+    return NULL;
+  }
+  XMEMSET(tmpHash, 0, sizeof(struct hash_s));
+
+  while ((capacity < hashSize) && (capacity < 0x80000000U))
+    capacity <<= 1;
+
+  if (swissAlloc(tmpHash, capacity) != TRUE) {
+    fprintf(stderr, "ERR - Unable to allocate hash buckets\n");
+    XFREE(tmpHash);
+    return NULL;
+  }
+
+#ifdef DEBUG
+  if (config->debug >= 4)
+    printf("DEBUG - Swiss hash initialized [%u]\n", tmpHash->size);
+#endif
+
+  return tmpHash;
+}
+
 /****
  *
  * Free hash table
@@ -190,29 +580,24 @@ struct hash_s *initHash(uint32_t hashSize)
 
 void freeHash(struct hash_s *hash)
 {
-  uint32_t key;
-  struct hashRec_s *record, *next;
-  
   if (hash == NULL)
     return;
-    
-  /* Free bucket chains and key strings */
-  if (hash->buckets != NULL) {
-    for (key = 0; key < hash->size; key++) {
-      record = hash->buckets[key];
-      while (record) {
-        next = record->next;
-        if (record->keyString)
-          XFREE(record->keyString);
-        record = next;
-      }
-    }
-    XFREE(hash->buckets);
+
+  /* keys and records live in blocks, nothing is freed per record */
+  if (hash->ctrl != NULL) {
+    XFREE(hash->ctrl);
+    XFREE(hash->slots);
   }
-  
-  /* Free memory pools */
+  if (hash->oldCtrl != NULL) {
+    XFREE(hash->oldCtrl);
+    XFREE(hash->oldSlots);
+  }
+  if (hash->buckets != NULL)
+    XFREE(hash->buckets);
+
+  freeKeyBlocks(hash);
   freePools(hash);
-  
+
   XFREE(hash);
 }
 
@@ -224,23 +609,47 @@ void freeHash(struct hash_s *hash)
 
 struct hashRec_s *addUniqueHashRec(struct hash_s *hash, const char *keyString, int keyLen, void *data)
 {
-  uint32_t hashValue;
+  if (!hash || !keyString)
+    return NULL;
+    
+  if (keyLen == 0)
+    keyLen = strlen(keyString) + 1;
+
+  return addUniqueHashRecWithHash(hash, keyString, keyLen, hashKey(keyString, keyLen), data);
+}
+
+/****
+ *
+ * Add unique record to hash, hashValue is hashKey() of the key
+ *
+ ****/
+
+struct hashRec_s *addUniqueHashRecWithHash(struct hash_s *hash, const char *keyString, int keyLen, uint64_t hashValue, void *data)
+{
   uint32_t bucket;
   struct hashRec_s *record, *newRecord;
   uint16_t depth = 0;
   
   if (!hash || !keyString)
     return NULL;
-    
-  if (keyLen == 0)
-    keyLen = strlen(keyString) + 1;
-    
-  /* Calculate hash and bucket */
-  hashValue = fnv1aHash(keyString, keyLen);
-  bucket = hashValue % hash->size;
+
+  if (hash->ctrl != NULL) {
+    if ((record = swissFind(hash, keyString, keyLen, hashValue)) != NULL) {
+      record->lastSeen = config->current_time;
+      record->accessCount++;
+      return NULL; /* Duplicate */
+    }
+    if (hash->oldCtrl != NULL)
+      swissMigrate(hash, SWISS_MIGRATE_STEP);
+    /* keep the table under 7/8 full, callers usually grow it sooner */
+    if (((uint64_t)hash->totalRecords + 1) * 8 > (uint64_t)hash->size * 7 &&
+        (hash->size >= 0x80000000U || swissResize(hash, hash->size * 2) != TRUE))
+      return NULL;
+  }
+  bucket = (uint32_t)hashValue % hash->size;
   
   /* Check for existing record */
-  record = hash->buckets[bucket];
+  record = (hash->ctrl != NULL) ? NULL : hash->buckets[bucket];
   while (record) {
     if (record->hashValue == hashValue &&
         record->keyLen == keyLen &&
@@ -260,8 +669,8 @@ struct hashRec_s *addUniqueHashRec(struct hash_s *hash, const char *keyString, i
     return NULL;
   }
   
-  /* Allocate and copy key string */
-  if ((newRecord->keyString = (char *)XMALLOC(keyLen)) == NULL) {
+  /* Copy the key into the arena */
+  if ((newRecord->keyString = allocHashKey(hash, keyLen)) == NULL) {
     fprintf(stderr, "ERR - Unable to allocate key string\n");
     return NULL;
   }
@@ -275,9 +684,13 @@ struct hashRec_s *addUniqueHashRec(struct hash_s *hash, const char *keyString, i
   newRecord->accessCount = 1;
   newRecord->modifyCount = 0;
   
-  /* Add to front of bucket chain */
-  newRecord->next = hash->buckets[bucket];
-  hash->buckets[bucket] = newRecord;
+  if (hash->ctrl != NULL)
+    depth = swissPlace(hash, newRecord);
+  else {
+    /* Add to front of bucket chain */
+    newRecord->next = hash->buckets[bucket];
+    hash->buckets[bucket] = newRecord;
+  }
   
   /* Update statistics */
   hash->totalRecords++;
@@ -301,19 +714,37 @@ struct hashRec_s *addUniqueHashRec(struct hash_s *hash, const char *keyString, i
 
 struct hashRec_s *getHashRecord(struct hash_s *hash, const char *keyString, int keyLen)
 {
-  uint32_t hashValue;
-  uint32_t bucket;
-  struct hashRec_s *record;
-  
   if (!hash || !keyString)
     return NULL;
     
   if (keyLen == 0)
     keyLen = strlen(keyString) + 1;
-    
-  /* Calculate hash and bucket */
-  hashValue = fnv1aHash(keyString, keyLen);
-  bucket = hashValue % hash->size;
+
+  return getHashRecordWithHash(hash, keyString, keyLen, hashKey(keyString, keyLen));
+}
+
+/****
+ *
+ * Get hash record, hashValue is hashKey() of the key
+ *
+ ****/
+
+struct hashRec_s *getHashRecordWithHash(struct hash_s *hash, const char *keyString, int keyLen, uint64_t hashValue)
+{
+  uint32_t bucket;
+  struct hashRec_s *record;
+  
+  if (!hash || !keyString)
+    return NULL;
+
+  if (hash->ctrl != NULL) {
+    if ((record = swissFind(hash, keyString, keyLen, hashValue)) != NULL) {
+      record->lastSeen = config->current_time;
+      record->accessCount++;
+    }
+    return record;
+  }
+  bucket = (uint32_t)hashValue % hash->size;
   
   /* Search bucket chain */
   record = hash->buckets[bucket];
@@ -332,6 +763,51 @@ struct hashRec_s *getHashRecord(struct hash_s *hash, const char *keyString, int
   return NULL; /* Not found */
 }
 
+/****
+ *
+ * Get hash record without updating access info (read only)
+ *
+ ****/
+
+struct hashRec_s *snoopHashRecord(struct hash_s *hash, const char *keyString, int keyLen)
+{
+  if (!hash || !keyString)
+    return NULL;
+    
+  if (keyLen == 0)
+    keyLen = strlen(keyString) + 1;
+
+  return snoopHashRecordWithHash(hash, keyString, keyLen, hashKey(keyString, keyLen));
+}
+
+/****
+ *
+ * Get hash record read only, hashValue is hashKey() of the key
+ *
+ ****/
+
+struct hashRec_s *snoopHashRecordWithHash(struct hash_s *hash, const char *keyString, int keyLen, uint64_t hashValue)
+{
+  uint32_t bucket;
+  struct hashRec_s *record;
+  
+  if (!hash || !keyString)
+    return NULL;
+
+  if (hash->ctrl != NULL)
+    return swissFind(hash, keyString, keyLen, hashValue);
+  bucket = (uint32_t)hashValue % hash->size;
+  
+  for (record = hash->buckets[bucket]; record; record = record->next) {
+    if (record->hashValue == hashValue &&
+        record->keyLen == keyLen &&
+        XMEMCMP(record->keyString, keyString, keyLen) == 0)
+      return record;
+  }
+  
+  return NULL; /* Not found */
+}
+
 /****
  *
  * Get hash data
@@ -364,6 +840,18 @@ int traverseHash(const struct hash_s *hash, int (*fn)(const struct hashRec_s *ha
     printf("DEBUG - Traversing hash table\n");
 #endif
   
+  if (hash->ctrl != NULL) {
+    for (bucket = 0; bucket < hash->size; bucket++)
+      if (!(hash->ctrl[bucket] & SWISS_EMPTY) && fn(hash->slots[bucket]))
+        return FAILED;
+    /* then whatever is still waiting to migrate */
+    if (hash->oldCtrl != NULL)
+      for (bucket = hash->migratePos; bucket < hash->oldSize; bucket++)
+        if (!(hash->oldCtrl[bucket] & SWISS_EMPTY) && fn(hash->oldSlots[bucket]))
+          return FAILED;
+    return TRUE;
+  }
+
   /* Traverse all buckets and their chains */
   for (bucket = 0; bucket < hash->size; bucket++) {
     record = hash->buckets[bucket];
@@ -386,9 +874,16 @@ int traverseHash(const struct hash_s *hash, int (*fn)(const struct hashRec_s *ha
 struct hash_s *dyGrowHash(struct hash_s *oldHash)
 {
   struct hash_s *newHash;
-  uint32_t bucket;
-  struct hashRec_s *record, *next, *newRecord;
+  uint32_t bucket, newBucket;
+  struct hashRec_s *record, *next;
   
+  /* swiss tables grow in place, a step at a time */
+  if (oldHash && oldHash->ctrl != NULL) {
+    if (oldHash->size < 0x80000000U)
+      swissResize(oldHash, oldHash->size * 2);
+    return oldHash;
+  }
+
   if (!oldHash || oldHash->primeOff >= (sizeof(hashPrimes)/sizeof(hashPrimes[0]) - 2))
     return oldHash;
     
@@ -398,55 +893,29 @@ struct hash_s *dyGrowHash(struct hash_s *oldHash)
     return oldHash;
   }
   
-  /* Rehash all records */
+  /* Relink the existing records, keys and pools move with them */
   for (bucket = 0; bucket < oldHash->size; bucket++) {
     record = oldHash->buckets[bucket];
     while (record) {
       next = record->next;
-      
-      /* Recalculate bucket in new table */
-      uint32_t newBucket = record->hashValue % newHash->size;
-      
-      /* Allocate new record */
-      if ((newRecord = allocHashRecord(newHash)) == NULL) {
-        fprintf(stderr, "ERR - Failed to allocate during grow\n");
-        freeHash(newHash);
-        return oldHash;
-      }
-      
-      /* Copy record (shallow copy of data pointer) */
-      newRecord->keyLen = record->keyLen;
-      newRecord->hashValue = record->hashValue;
-      newRecord->data = record->data;
-      newRecord->lastSeen = record->lastSeen;
-      newRecord->createTime = record->createTime;
-      newRecord->accessCount = record->accessCount;
-      newRecord->modifyCount = record->modifyCount;
-      
-      /* Allocate and copy key */
-      if ((newRecord->keyString = (char *)XMALLOC(record->keyLen)) == NULL) {
-        fprintf(stderr, "ERR - Failed to allocate key during grow\n");
-        freeHash(newHash);
-        return oldHash;
-      }
-      XMEMCPY(newRecord->keyString, record->keyString, record->keyLen);
-      
-      /* Add to new hash bucket */
-      newRecord->next = newHash->buckets[newBucket];
-      newHash->buckets[newBucket] = newRecord;
-      newHash->totalRecords++;
-      
+      newBucket = (uint32_t)record->hashValue % newHash->size;
+      record->next = newHash->buckets[newBucket];
+      newHash->buckets[newBucket] = record;
       record = next;
     }
   }
+  newHash->totalRecords = oldHash->totalRecords;
+  newHash->pools = oldHash->pools;
+  newHash->keyBlocks = oldHash->keyBlocks;
   
 #ifdef DEBUG
   if (config->debug >= 2)
     printf("DEBUG - Grew hash from %u to %u buckets\n", oldHash->size, newHash->size);
 #endif
   
-  /* Free old hash */
-  freeHash(oldHash);
+  /* Free old bucket array */
+  XFREE(oldHash->buckets);
+  XFREE(oldHash);
   
   return newHash;
 }
@@ -459,7 +928,7 @@ struct hash_s *dyGrowHash(struct hash_s *oldHash)
 
 uint32_t calcHashWithLen(const char *keyString, int keyLen)
 {
-  return fnv1aHash(keyString, keyLen);
+  return hashKey(keyString, keyLen);
 }
 
 /****
@@ -470,7 +939,7 @@ uint32_t calcHashWithLen(const char *keyString, int keyLen)
 
 uint32_t calcHash(uint32_t hashSize, const char *keyString)
 {
-  return fnv1aHash(keyString, strlen(keyString) + 1) % hashSize;
+  return (uint32_t)hashKey(keyString, strlen(keyString) + 1) % hashSize;
 }
 
 /****
@@ -44,6 +44,20 @@
 #include "../include/common.h"
 #include <stdint.h>
 
+/****
+ *
+ * defines
+ *
+ ****/
+
+/* open addressing (swiss) table layout */
+#define SWISS_GROUP 16           /* control bytes compared per probe */
+#define SWISS_EMPTY 0x80         /* control byte of a free slot, full slots hold a 7 bit tag */
+#define SWISS_MIN_SIZE 64        /* smallest capacity, a power of two */
+#define SWISS_MIGRATE_STEP 64    /* old slots moved per insert while growing */
+
+#define KEY_BLOCK_SIZE (256 * 1024) /* key arena block, longer keys get one of their own */
+
 /****
  *
  * typedefs and enums
@@ -54,16 +68,25 @@ struct hashRec_s
 {
   char *keyString;
   int keyLen;
-  uint32_t hashValue;    /* Cached hash value for faster lookups */
+  uint32_t accessCount;
+  uint64_t hashValue;    /* hashKey() of the key, cached for lookups and growth */
   void *data;
   time_t lastSeen;
   time_t createTime;
-  uint32_t accessCount;
   uint16_t modifyCount;
   struct hashRec_s *next;  /* For linked list in buckets */
 };
 
 
+/* key arena block, keys are packed back to back and freed with the hash */
+struct hashKeyBlock_s
+{
+  struct hashKeyBlock_s *next;
+  size_t size;
+  size_t used;
+  char keys[];
+};
+
 /* Memory pool for hash records */
 struct hashRecPool_s
 {
@@ -79,8 +102,17 @@ struct hash_s
   uint32_t totalRecords;
   uint16_t maxDepth;
   uint8_t primeOff;
-  struct hashRec_s **buckets;      /* Optimized bucket array using FNV-1a */
+  struct hashRec_s **buckets;      /* chains, indexed by the low hash bits mod size */
   struct hashRecPool_s *pools;     /* Memory pools for records */
+  struct hashKeyBlock_s *keyBlocks; /* key arena, block being filled first */
+  uint8_t *ctrl;                   /* swiss control bytes, NULL for chained tables */
+  struct hashRec_s **slots;        /* swiss record slots, parallel to ctrl */
+  uint32_t groupMask;              /* swiss probe groups - 1 */
+  uint8_t *oldCtrl;                /* table being migrated, NULL when not growing */
+  struct hashRec_s **oldSlots;
+  uint32_t oldSize;
+  uint32_t oldGroupMask;
+  uint32_t migratePos;             /* old slots below this have moved */
 };
 
 /****
@@ -90,18 +122,21 @@ struct hash_s
  ****/
 
 uint32_t calcHash(uint32_t hashSize, const char *keyString);
-uint32_t fnv1aHash(const char *keyString, int keyLen);
+uint64_t hashKey(const char *keyString, int keyLen);
 uint32_t djb2Hash(const char *keyString, int keyLen);
 uint32_t calcHashWithLen(const char *keyString, int keyLen);
 struct hash_s *initHash(uint32_t hashSize);
+struct hash_s *initSwissHash(uint32_t hashSize);
 void freeHash(struct hash_s *hash);
 
 struct hashRec_s *addUniqueHashRec(struct hash_s *hash, const char *keyString, int keyLen, void *data);
-struct hashRec_s *addUniqueHashRecWithHash(struct hash_s *hash, const char *keyString, int keyLen, uint32_t hashValue, void *data);
+struct hashRec_s *addUniqueHashRecWithHash(struct hash_s *hash, const char *keyString, int keyLen, uint64_t hashValue, void *data);
 int insertUniqueHashRec(struct hash_s *hash, struct hashRec_s *hashRec);
 
 struct hashRec_s *getHashRecord(struct hash_s *hash, const char *keyString, int keyLen);
+struct hashRec_s *getHashRecordWithHash(struct hash_s *hash, const char *keyString, int keyLen, uint64_t hashValue);
 struct hashRec_s *snoopHashRecord(struct hash_s *hash, const char *keyString, int keyLen);
+struct hashRec_s *snoopHashRecordWithHash(struct hash_s *hash, const char *keyString, int keyLen, uint64_t hashValue);
 void *getHashData(struct hash_s *hash, const char *keyString, int keyLen);
 void *snoopHashData(struct hash_s *hash, const char *keyString, int keyLen);
 
@@ -0,0 +1,260 @@
+/*****
+ *
+ * Description: Template Hash Benchmark
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+/****
+ *
+ * compares the chained and swiss template hashes with keys shaped
+ * like templates, from 10^3 up to the count given on the command line
+ * (10^6 by default), and hashKey() with the byte at a time FNV-1a it
+ * replaced
+ *
+ * build with 'make hash_bench' in src/
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "hash.h"
+#include "mem.h"
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+#define BENCH_KEY_SIZE 64
+#define BENCH_HASH_BYTES (256 * 1024 * 1024) /* hashed per key length */
+
+/****
+ *
+ * global variables
+ *
+ ****/
+
+PUBLIC int quit = FALSE;
+PUBLIC int reload = FALSE;
+PUBLIC Config_t *config = NULL;
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+PRIVATE double nowSec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec / 1e9);
+}
+
+/****
+ *
+ * build count template strings, miss keys follow the hit keys
+ *
+ ****/
+
+PRIVATE char *makeKeys(uint32_t count, int *keyLens)
+{
+  char *keys;
+  uint32_t i;
+
+  keys = (char *)XMALLOC((size_t)count * 2 * BENCH_KEY_SIZE);
+  for (i = 0; i < count * 2; i++)
+    keyLens[i] = snprintf(keys + ((size_t)i * BENCH_KEY_SIZE), BENCH_KEY_SIZE,
+                          "%%t %%s sshd[%%d]: %s %%s %u port %%d%s",
+                          (i & 1) ? "Accepted" : "Failed", i,
+                          (i < count) ? "" : " ssh2") + 1;
+  return keys;
+}
+
+/****
+ *
+ * time inserts, hits and misses against one table
+ *
+ ****/
+
+PRIVATE void benchHash(const char *name, int swiss, uint32_t count, const char *keys, const int *keyLens, const uint32_t *order)
+{
+  struct hash_s *hash;
+  double start, insertTime, hitTime, missTime, freeTime, lineStart, lineTime, worstTime = 0;
+  uint32_t i, size, found = 0;
+
+  hash = swiss ? initSwissHash(389) : initHash(389);
+  if (hash == NULL)
+    return;
+
+  /* grow the way the template loop does */
+  start = nowSec();
+  for (i = 0; i < count; i++)
+  {
+    lineStart = nowSec();
+    addUniqueHashRec(hash, keys + ((size_t)i * BENCH_KEY_SIZE), keyLens[i], NULL);
+    if (hash->totalRecords * 4 > hash->size * 3)
+      hash = dyGrowHash(hash);
+    /* the slowest insert is the latency spike a growth step adds */
+    if ((lineTime = nowSec() - lineStart) > worstTime)
+      worstTime = lineTime;
+  }
+  insertTime = nowSec() - start;
+
+  start = nowSec();
+  for (i = 0; i < count; i++)
+    if (getHashRecord(hash, keys + ((size_t)order[i] * BENCH_KEY_SIZE), keyLens[order[i]]) != NULL)
+      found++;
+  hitTime = nowSec() - start;
+
+  start = nowSec();
+  for (i = count; i < count * 2; i++)
+    if (getHashRecord(hash, keys + ((size_t)i * BENCH_KEY_SIZE), keyLens[i]) != NULL)
+      found++;
+  missTime = nowSec() - start;
+
+  size = hash->size;
+  start = nowSec();
+  freeHash(hash);
+  freeTime = nowSec() - start;
+
+  printf("%10u %-8s %10u %9.1f %9.1f %9.1f %9.1f %9.2f%s\n", count, name, size,
+         insertTime * 1e9 / count, worstTime * 1e6, hitTime * 1e9 / count, missTime * 1e9 / count,
+         freeTime * 1e3, (found == count) ? "" : " LOOKUP ERROR");
+}
+
+/****
+ *
+ * FNV-1a, the template hash before hashKey()
+ *
+ ****/
+
+PRIVATE uint32_t fnv1a(const char *keyString, int keyLen)
+{
+  uint32_t h = 2166136261U;
+  int i;
+
+  for (i = 0; i < keyLen; i++)
+    h = (h ^ (uint8_t)keyString[i]) * 16777619U;
+  return h;
+}
+
+/****
+ *
+ * hash throughput by key length
+ *
+ ****/
+
+PRIVATE void benchKeyHash(void)
+{
+  static const int lens[] = {8, 16, 32, 64, 128, 256, 1024, 0};
+  char *buf;
+  double start, fnvTime, keyTime;
+  volatile uint64_t sink = 0;            /* keeps the calls alive */
+  size_t n, rounds;
+  int i;
+
+  buf = (char *)XMALLOC(1024 + 64);
+  for (i = 0; i < 1024 + 64; i++)
+    buf[i] = (char)('%' + (i * 7) % 90);
+
+  printf("%10s %12s %12s %8s\n", "key bytes", "fnv1a GB/s", "hashKey GB/s", "speedup");
+  for (i = 0; lens[i] != 0; i++)
+  {
+    rounds = BENCH_HASH_BYTES / (size_t)lens[i];
+
+    start = nowSec();
+    for (n = 0; n < rounds; n++)
+      sink += fnv1a(buf + (n & 63), lens[i]);
+    fnvTime = nowSec() - start;
+
+    start = nowSec();
+    for (n = 0; n < rounds; n++)
+      sink += hashKey(buf + (n & 63), lens[i]);
+    keyTime = nowSec() - start;
+
+    printf("%10d %12.2f %12.2f %7.1fx\n", lens[i], BENCH_HASH_BYTES / fnvTime / 1e9,
+           BENCH_HASH_BYTES / keyTime / 1e9, fnvTime / keyTime);
+  }
+  printf("\n");
+  XFREE(buf);
+}
+
+/****
+ *
+ * main
+ *
+ ****/
+
+int main(int argc, char *argv[])
+{
+  Config_t bConfig;
+  uint32_t maxCount = 1000000, count, i, j, tmp, seed = 12345;
+  uint32_t *order;
+  int *keyLens;
+  char *keys;
+
+  XMEMSET(&bConfig, 0, sizeof(bConfig));
+  config = &bConfig;
+  config->current_time = time(NULL);
+
+  if (argc > 1)
+    maxCount = (uint32_t)strtoul(argv[1], NULL, 10);
+
+  benchKeyHash();
+
+  printf("%10s %-8s %10s %9s %9s %9s %9s %9s\n", "templates", "table", "size", "insert", "worst", "hit", "miss", "free");
+  printf("%10s %-8s %10s %9s %9s %9s %9s %9s\n", "", "", "", "ns/op", "us", "ns/op", "ns/op", "ms");
+
+  for (count = 1000; count <= maxCount; count *= 10)
+  {
+    keyLens = (int *)XMALLOC(sizeof(int) * count * 2);
+    order = (uint32_t *)XMALLOC(sizeof(uint32_t) * count);
+    keys = makeKeys(count, keyLens);
+
+    /* look keys up in a different order than they went in */
+    for (i = 0; i < count; i++)
+      order[i] = i;
+    for (i = count - 1; i > 0; i--)
+    {
+      seed = (seed * 1103515245U) + 12345U;
+      j = seed % (i + 1);
+      tmp = order[i];
+      order[i] = order[j];
+      order[j] = tmp;
+    }
+
+    benchHash("chained", FALSE, count, keys, keyLens, order);
+    benchHash("swiss", TRUE, count, keys, keyLens, order);
+
+    XFREE(keys);
+    XFREE(order);
+    XFREE(keyLens);
+    if (count > UINT32_MAX / 20)
+      break;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+/*****
+ *
+ * Description: HyperLogLog Distinct Value Estimate Functions
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+/****
+ *
+ * estimates the number of distinct values of a template field from
+ * their hashes, in at most HLL_REGISTERS bytes however many there are.
+ * sketches built by different workers merge by taking the larger rank
+ * of each register
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "hll.h"
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * switch a sketch from the sparse list to registers
+ *
+ ****/
+
+PRIVATE void hllDensify(hll_t *hll)
+{
+  uint16_t i;
+
+  hll->regs = (uint8_t *)XMALLOC(HLL_REGISTERS);
+  XMEMSET(hll->regs, 0, HLL_REGISTERS);
+  for (i = 0; i < hll->used; i++)
+    hll->regs[hll->sparse[i] >> HLL_RANK_BITS] = (uint8_t)(hll->sparse[i] & ((1 << HLL_RANK_BITS) - 1));
+
+  if (hll->sparse != NULL)
+    XFREE(hll->sparse);
+  hll->sparse = NULL;
+  hll->used = hll->size = 0;
+}
+
+/****
+ *
+ * raise a register to rank
+ *
+ ****/
+
+PRIVATE void hllSet(hll_t *hll, uint32_t idx, uint8_t rank)
+{
+  uint16_t i;
+
+  if (hll->regs != NULL)
+  {
+    if (hll->regs[idx] < rank)
+      hll->regs[idx] = rank;
+    return;
+  }
+
+  for (i = 0; i < hll->used; i++)
+  {
+    if ((uint32_t)(hll->sparse[i] >> HLL_RANK_BITS) == idx)
+    {
+      if ((hll->sparse[i] & ((1 << HLL_RANK_BITS) - 1)) < rank)
+        hll->sparse[i] = (uint16_t)((idx << HLL_RANK_BITS) | rank);
+      return;
+    }
+  }
+
+  if (hll->used == HLL_SPARSE_MAX)
+  {
+    hllDensify(hll);
+    hll->regs[idx] = rank;
+    return;
+  }
+
+  if (hll->used == hll->size)
+  {
+    hll->size = (hll->size == 0) ? HLL_SPARSE_MIN : (uint16_t)(hll->size * 2);
+    hll->sparse = (uint16_t *)XREALLOC(hll->sparse, sizeof(uint16_t) * hll->size);
+  }
+  hll->sparse[hll->used++] = (uint16_t)((idx << HLL_RANK_BITS) | rank);
+}
+
+/****
+ *
+ * add the hash of a value
+ *
+ ****/
+
+void hllAdd(hll_t *hll, uint64_t hash)
+{
+  uint64_t rest = hash << HLL_PRECISION;
+  uint8_t rank;
+
+  /* position of the first set bit after the index bits */
+  if (rest == 0)
+    rank = 64 - HLL_PRECISION + 1;
+  else
+    rank = (uint8_t)(__builtin_clzll(rest) + 1);
+
+  hllSet(hll, (uint32_t)(hash >> (64 - HLL_PRECISION)), rank);
+}
+
+/****
+ *
+ * fold src into dst
+ *
+ ****/
+
+void hllMerge(hll_t *dst, const hll_t *src)
+{
+  uint32_t i;
+
+  if (src->regs != NULL)
+  {
+    if (dst->regs == NULL)
+      hllDensify(dst);
+    for (i = 0; i < HLL_REGISTERS; i++)
+      if (dst->regs[i] < src->regs[i])
+        dst->regs[i] = src->regs[i];
+  }
+  else
+    for (i = 0; i < src->used; i++)
+      hllSet(dst, (uint32_t)(src->sparse[i] >> HLL_RANK_BITS), (uint8_t)(src->sparse[i] & ((1 << HLL_RANK_BITS) - 1)));
+}
+
+/****
+ *
+ * estimated number of distinct values added
+ *
+ * the raw harmonic mean estimate with linear counting while empty
+ * registers remain and the estimate is small, the 64 bit hash makes a
+ * large range correction unnecessary
+ *
+ ****/
+
+uint64_t hllEstimate(const hll_t *hll)
+{
+  const double m = (double)HLL_REGISTERS;
+  double sum = 0.0, est;
+  uint32_t i, zeros = 0;
+
+  if (hll->regs != NULL)
+  {
+    for (i = 0; i < HLL_REGISTERS; i++)
+    {
+      sum += 1.0 / (double)(1ULL << hll->regs[i]);
+      if (hll->regs[i] == 0)
+        zeros++;
+    }
+  }
+  else
+  {
+    /* registers missing from the list are zero */
+    zeros = HLL_REGISTERS - hll->used;
+    sum = (double)zeros;
+    for (i = 0; i < hll->used; i++)
+      sum += 1.0 / (double)(1ULL << (hll->sparse[i] & ((1 << HLL_RANK_BITS) - 1)));
+  }
+
+  est = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+  if ((est <= 2.5 * m) && (zeros > 0))
+    est = m * log(m / (double)zeros);
+
+  return (uint64_t)(est + 0.5);
+}
+
+/****
+ *
+ * release a sketch, leaving it empty
+ *
+ ****/
+
+void hllFree(hll_t *hll)
+{
+  if (hll->sparse != NULL)
+    XFREE(hll->sparse);
+  if (hll->regs != NULL)
+    XFREE(hll->regs);
+  hll->sparse = NULL;
+  hll->regs = NULL;
+  hll->used = hll->size = 0;
+}
@@ -0,0 +1,87 @@
+/*****
+ *
+ * Description: HyperLogLog Distinct Value Estimate Headers
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#ifndef HLL_DOT_H
+#define HLL_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+#include "mem.h"
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+#define HLL_PRECISION 10                   /* index bits, about 3% standard error */
+#define HLL_REGISTERS (1 << HLL_PRECISION)
+#define HLL_RANK_BITS 6                    /* ranks run 1 to 64 - HLL_PRECISION + 1 */
+#define HLL_SPARSE_MIN 4
+#define HLL_SPARSE_MAX 128                 /* sparse entries before switching to registers */
+
+/****
+ *
+ * typedefs & structs
+ *
+ ****/
+
+/*
+ * a sketch starts sparse, a short list of index << HLL_RANK_BITS | rank
+ * entries, and switches to one byte registers once the list would
+ * outgrow a quarter of them.  an empty sketch allocates nothing
+ */
+typedef struct hll_s
+{
+  uint16_t *sparse;
+  uint8_t *regs;                           /* HLL_REGISTERS bytes once dense */
+  uint16_t used;                           /* sparse entries */
+  uint16_t size;
+} hll_t;
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+void hllAdd(hll_t *hll, uint64_t hash);
+void hllMerge(hll_t *dst, const hll_t *src);
+uint64_t hllEstimate(const hll_t *hll);
+void hllFree(hll_t *hll);
+
+#endif /* HLL_DOT_H */
@@ -0,0 +1,287 @@
+/*****
+ *
+ * Description: Input Line Reader Functions
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "input.h"
+
+/****
+ *
+ * external variables
+ *
+ ****/
+
+extern Config_t *config;
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * open a file for line reading, '-' reads stdin
+ *
+ * regular files are mapped and read in place, everything else is
+ * read through a buffer. gzip, zstd, xz and bzip2 input is recognized
+ * by its magic bytes and decompressed on the fly
+ *
+ ****/
+
+input_t *openInput(const char *fName)
+{
+  input_t *in;
+  struct stat st;
+  ssize_t rCount;
+  int fd, format;
+
+  if (strcmp(fName, "-") == 0)
+    fd = STDIN_FILENO;
+  else if ((fd = open(fName, O_RDONLY | O_NOFOLLOW)) == -1)
+  {
+    if (errno == ELOOP)
+      fprintf(stderr, "ERR - Symbolic link detected, access denied: %s\n", fName);
+    return NULL;
+  }
+
+  in = (input_t *)XMALLOC(sizeof(input_t));
+  XMEMSET(in, 0, sizeof(input_t));
+  in->fd = fd;
+  in->isStdin = (fd == STDIN_FILENO);
+
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+  if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0))
+  {
+    if ((in->map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+      in->map = NULL;
+    else
+    {
+      in->mapLen = (size_t)st.st_size;
+#ifdef HAVE_MADVISE
+      madvise(in->map, in->mapLen, MADV_SEQUENTIAL);
+#endif
+#ifdef DEBUG
+      if (config->debug >= 2)
+        fprintf(stderr, "DEBUG - Mapped [%s] (%lu bytes)\n", fName, (unsigned long)in->mapLen);
+#endif
+    }
+  }
+#endif
+
+  if (in->map != NULL)
+    format = detectCompression((const unsigned char *)in->map, in->mapLen);
+  else
+  { /* peek at the head of the stream, the bytes are kept for the reader */
+    in->buf = (char *)XMALLOC(INPUT_READ_SIZE + 1);
+    while (!in->eof && (in->bufLen < COMPRESS_MAGIC_LEN))
+    {
+      if ((rCount = read(fd, in->buf + in->bufLen, INPUT_READ_SIZE - in->bufLen)) > 0)
+        in->bufLen += (size_t)rCount;
+      else if ((rCount == -1) && (errno == EINTR))
+        continue;
+      else
+        in->eof = TRUE;
+    }
+    format = detectCompression((const unsigned char *)in->buf, in->bufLen);
+  }
+
+  if (format != COMPRESS_NONE)
+  {
+    if (!compressionSupported(format))
+    {
+      fprintf(stderr, "ERR - %s input is not supported by this build: %s\n", compressionName(format), fName);
+      closeInput(in);
+      errno = ENOTSUP;
+      return NULL;
+    }
+
+    if (in->map != NULL)
+      in->dec = initDecoder(format, -1, in->map, in->mapLen);
+    else
+      in->dec = initDecoder(format, fd, in->buf, in->bufLen);
+    if (in->dec == NULL)
+    {
+      closeInput(in);
+      return NULL;
+    }
+    in->bufLen = 0;
+    in->eof = FALSE;
+  }
+
+  return in;
+}
+
+/****
+ *
+ * lines returned by readInputLine() stay valid until the input is
+ * closed when TRUE, otherwise only until the next read
+ *
+ ****/
+
+int inputIsMapped(const input_t *in)
+{
+  return ((in->map != NULL) && (in->dec == NULL));
+}
+
+/****
+ *
+ * refill the stream buffer, keeping any partial line
+ *
+ ****/
+
+PRIVATE void fillInputBuffer(input_t *in)
+{
+  ssize_t rCount;
+
+  if (in->buf == NULL)
+    in->buf = (char *)XMALLOC(INPUT_READ_SIZE + 1);
+
+  if (in->bufPos > 0)
+  {
+    memmove(in->buf, in->buf + in->bufPos, in->bufLen - in->bufPos);
+    in->bufLen -= in->bufPos;
+    in->bufPos = 0;
+  }
+
+  while (!in->eof && (in->bufLen < INPUT_READ_SIZE))
+  {
+    if (in->dec != NULL)
+      rCount = readDecoder(in->dec, in->buf + in->bufLen, INPUT_READ_SIZE - in->bufLen);
+    else
+      rCount = read(in->fd, in->buf + in->bufLen, INPUT_READ_SIZE - in->bufLen);
+
+    if (rCount > 0)
+      in->bufLen += (size_t)rCount;
+    else if ((rCount == -1) && (in->dec == NULL) && (errno == EINTR))
+      continue;
+    else
+    {
+      /* decoder errors have already been reported */
+      if ((rCount == -1) && (in->dec == NULL))
+        fprintf(stderr, "ERR - Read failed %d (%s)\n", errno, strerror(errno));
+      in->eof = TRUE;
+    }
+    /* hand out what we have as soon as it holds a full line */
+    if (memchr(in->buf, '\n', in->bufLen) != NULL)
+      break;
+  }
+}
+
+/****
+ *
+ * get the next line
+ *
+ * line points at the line including its newline, it is not nul
+ * terminated. the newline search uses memchr(), which libc already
+ * implements with vector instructions
+ *
+ ****/
+
+int readInputLine(input_t *in, char **line, size_t *lineLen)
+{
+  char *start, *nl;
+  size_t avail, len;
+
+  if (inputIsMapped(in))
+  {
+    if (in->mapPos >= in->mapLen)
+      return FALSE;
+
+    start = in->map + in->mapPos;
+    avail = in->mapLen - in->mapPos;
+    if ((nl = memchr(start, '\n', (avail < INPUT_MAX_LINE) ? avail : INPUT_MAX_LINE)) != NULL)
+      len = (size_t)(nl - start) + 1;
+    else if (avail > INPUT_MAX_LINE)
+      len = INPUT_MAX_LINE;
+    else
+    {
+      /* unterminated last line, copy it so readers never touch past the mapping */
+      if (in->buf == NULL)
+        in->buf = (char *)XMALLOC(INPUT_READ_SIZE + 1);
+      XMEMCPY(in->buf, start, avail);
+      in->buf[avail] = '\0';
+      in->mapPos = in->mapLen;
+      *line = in->buf;
+      *lineLen = avail;
+      return TRUE;
+    }
+
+    in->mapPos += len;
+    *line = start;
+    *lineLen = len;
+    return TRUE;
+  }
+
+  /* streaming path */
+  if ((in->buf == NULL) || ((nl = memchr(in->buf + in->bufPos, '\n', in->bufLen - in->bufPos)) == NULL))
+  {
+    if ((in->buf == NULL) || ((in->bufLen - in->bufPos) < INPUT_MAX_LINE))
+      fillInputBuffer(in);
+    nl = memchr(in->buf + in->bufPos, '\n', in->bufLen - in->bufPos);
+  }
+
+  avail = in->bufLen - in->bufPos;
+  if (avail == 0)
+    return FALSE;
+
+  start = in->buf + in->bufPos;
+  if ((nl != NULL) && ((size_t)(nl - start) < INPUT_MAX_LINE))
+    len = (size_t)(nl - start) + 1;
+  else if (avail > INPUT_MAX_LINE)
+    len = INPUT_MAX_LINE;
+  else
+    len = avail;
+
+  in->bufPos += len;
+  *line = start;
+  *lineLen = len;
+  return TRUE;
+}
+
+/****
+ *
+ * close input and release buffers
+ *
+ ****/
+
+void closeInput(input_t *in)
+{
+  if (in == NULL)
+    return;
+
+  /* stop the decoder before its input goes away */
+  deInitDecoder(in->dec);
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+  if (in->map != NULL)
+    munmap(in->map, in->mapLen);
+#endif
+  if (in->buf != NULL)
+    XFREE(in->buf);
+  if (!in->isStdin)
+    close(in->fd);
+  XFREE(in);
+}
@@ -0,0 +1,95 @@
+/*****
+ *
+ * Description: Input Line Reader Headers
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#ifndef INPUT_DOT_H
+#define INPUT_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+#include "mem.h"
+#include "decompress.h"
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+/* longest line handed out, longer lines are split the way fgets() into a 64KB buffer did */
+#define INPUT_MAX_LINE 65535
+
+/* streaming read size, must be larger than INPUT_MAX_LINE */
+#define INPUT_READ_SIZE (256 * 1024)
+
+/****
+ *
+ * typedefs & structs
+ *
+ ****/
+
+typedef struct input_s
+{
+  int fd;
+  int isStdin;
+
+  /* mmap path, regular files */
+  char *map;
+  size_t mapLen;
+  size_t mapPos;
+
+  /* compressed input, read through the streaming path */
+  decoder_t *dec;
+
+  /* streaming path, pipes and stdin, also holds an unterminated last line */
+  char *buf;
+  size_t bufLen;
+  size_t bufPos;
+  int eof;
+} input_t;
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+input_t *openInput(const char *fName);
+int readInputLine(input_t *in, char **line, size_t *lineLen);
+int inputIsMapped(const input_t *in);
+void closeInput(input_t *in);
+
+#endif /* INPUT_DOT_H */
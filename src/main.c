@@ -29,6 +29,7 @@
 #include "main.h"
 #include "string_intern.h"
 #include "parser_interface.h"
+#include "cpu.h"
 
 /****
  *
@@ -45,6 +46,7 @@
 PUBLIC int quit = FALSE;
 PUBLIC int reload = FALSE;
 PUBLIC Config_t *config = NULL;
+PUBLIC output_t *reportOut = NULL;
 
 /****
  *
@@ -204,6 +206,8 @@ PRIVATE FILE *secure_fopen(const char *path, const char *mode)
 int main(int argc, char *argv[])
 {
   PRIVATE int c = 0;
+  int i;
+  char *writeFile = NULL;
 
 #ifndef DEBUG
   struct rlimit rlim;
@@ -222,6 +226,9 @@ int main(int argc, char *argv[])
   /* default parser */
   config->parser_type = PARSER_TYPE_LEGACY;
 
+  /* single parser thread unless asked otherwise */
+  config->threads = 1;
+
   /* store current pid */
   config->cur_pid = getpid();
 
@@ -236,6 +243,7 @@ int main(int argc, char *argv[])
     static struct option long_options[] = {
         {"cluster", no_argument, 0, 'c'},
         {"greedy", no_argument, 0, 'g'},
+        {"estimate", no_argument, 0, 'e'},
         {"version", no_argument, 0, 'v'},
         {"debug", required_argument, 0, 'd'},
         {"help", no_argument, 0, 'h'},
@@ -246,12 +254,20 @@ int main(int argc, char *argv[])
         {"matchfile", required_argument, 0, 'M'},
         {"line", required_argument, 0, 'l'},
         {"linefile", required_argument, 0, 'L'},
+        {"threads", required_argument, 0, 'T'},
+        {"follow", no_argument, 0, 'f'},
+        {"shape-cache", no_argument, 0, 'S'},
+        {"teardown", no_argument, 0, 'X'},
+        {"sort", required_argument, 0, 's'},
+        {"top", required_argument, 0, 'H'},
+        {"bottom", required_argument, 0, 'B'},
+        {"binary", no_argument, 0, 'b'},
         {"quiet", no_argument, 0, 'q'},
         {"no-output", no_argument, 0, 'q'},
         {0, no_argument, 0, 0}};
-    c = getopt_long(argc, argv, "vd:hn:t:w:cCgm:M:l:L:q", long_options, &option_index);
+    c = getopt_long(argc, argv, "vd:efhn:St:T:w:cCgm:M:l:L:qXs:H:B:b", long_options, &option_index);
 #else
-    c = getopt(argc, argv, "vd:htn::w:cgm:M:l:L:q");
+    c = getopt(argc, argv, "vd:efhtn::ST:w:cgm:M:l:L:qXs:H:B:b");
 #endif
 
     if (c == -1)
@@ -278,6 +294,22 @@ int main(int argc, char *argv[])
       }
       break;
 
+    case 'e':
+      /* estimate distinct values of variable fields, needs clustering */
+      config->estimate = TRUE;
+      config->cluster = TRUE;
+      break;
+
+    case 'f':
+      /* keep reading files as they grow */
+      config->follow = TRUE;
+      break;
+
+    case 'S':
+      /* reuse parses of repeated line shapes */
+      config->shapeCache = TRUE;
+      break;
+
     case 'g':
       /* ignore quotes */
       config->greedy = TRUE;
@@ -309,15 +341,11 @@ int main(int argc, char *argv[])
       return (EXIT_SUCCESS);
 
     case 'w':
-      /* save templates to file */
+      /* save templates to file, opened once every -t file is loaded */
       if (!validate_file_path(optarg)) {
         return (EXIT_FAILURE);
       }
-      if ((config->outFile_st = secure_fopen(optarg, "w")) == NULL)
-      {
-        fprintf(stderr, "ERR - Unable to open template file for write [%s]\n", optarg);
-        return (EXIT_FAILURE);
-      }
+      writeFile = optarg;
       break;
 
     case 'M':
@@ -346,20 +374,98 @@ int main(int argc, char *argv[])
       config->match = addMatchLine(optarg);
       break;
 
+    case 'T':
+      /* number of parser threads */
+      if (!safe_parse_int(optarg, 1, PIPELINE_MAX_THREADS, &config->threads)) {
+        fprintf(stderr, "ERR - Invalid thread count: %s (must be 1-%d)\n", optarg, PIPELINE_MAX_THREADS);
+        return (EXIT_FAILURE);
+      }
+      break;
+
     case 'q':
       /* enable quiet mode - skip printing templates at end */
       config->no_output = TRUE;
       break;
 
+    case 'X':
+      /* free everything on the way out, for leak checkers */
+      config->teardown = TRUE;
+      break;
+
+    case 'b':
+      /* -w writes a template database */
+      config->writeDb = TRUE;
+      break;
+
+    case 's':
+      /* report order */
+      if (strcmp(optarg, "count") == 0)
+        config->sortKey = SORT_COUNT;
+      else if (strcmp(optarg, "first-seen") == 0)
+        config->sortKey = SORT_FIRST_SEEN;
+      else if (strcmp(optarg, "template") == 0)
+        config->sortKey = SORT_TEMPLATE;
+      else {
+        fprintf(stderr, "ERR - Invalid sort order: %s (must be count, first-seen or template)\n", optarg);
+        return (EXIT_FAILURE);
+      }
+      break;
+
+    case 'H':
+      /* only report the most seen templates */
+      if (!safe_parse_int(optarg, 1, INT_MAX, &config->topCount)) {
+        fprintf(stderr, "ERR - Invalid template count: %s\n", optarg);
+        return (EXIT_FAILURE);
+      }
+      config->bottomCount = 0;
+      break;
+
+    case 'B':
+      /* only report the least seen templates */
+      if (!safe_parse_int(optarg, 1, INT_MAX, &config->bottomCount)) {
+        fprintf(stderr, "ERR - Invalid template count: %s\n", optarg);
+        return (EXIT_FAILURE);
+      }
+      config->topCount = 0;
+      break;
+
     default:
       fprintf(stderr, "Unknown option code [0%o]\n", c);
     }
   }
 
+  if (writeFile != NULL)
+  {
+    /* truncating a mapped database would pull it out from under us */
+    if (templateDbLoaded(writeFile)) {
+      fprintf(stderr, "ERR - Template file [%s] is a database loaded with -t, write to another file\n", writeFile);
+      return (EXIT_FAILURE);
+    }
+    if ((config->outFile_st = secure_fopen(writeFile, "w")) == NULL)
+    {
+      fprintf(stderr, "ERR - Unable to open template file for write [%s]\n", writeFile);
+      return (EXIT_FAILURE);
+    }
+  }
+
   /* override cluster depth */
   if ((config->clusterDepth <= 0) || (config->clusterDepth > 10000))
     config->clusterDepth = MAX_ARGS_IN_FIELD;
 
+#ifdef MEM_DEBUG
+  /* the debug allocator reports what is still allocated at exit */
+  config->teardown = TRUE;
+#endif
+
+#if !defined(HAVE_PTHREAD_H) || defined(MEM_DEBUG)
+  /* no thread support or the debug allocator is not thread safe */
+  if (config->threads > 1)
+  {
+    fprintf(stderr, "ERR - Multiple threads not supported in this build, using one\n");
+    config->threads = 1;
+  }
+#endif
+
   /* check dirs and files for danger */
 
   if (time(&config->current_time) == -1)
@@ -383,6 +489,17 @@ int main(int argc, char *argv[])
 
   config->cur_pid = getpid();
 
+  /* pick the kernels for the cpu we are running on, before any thread starts */
+  initCpuFeatures();
+
+  /* templates and matched lines, stdio is left to diagnostics */
+  if ((reportOut = openOutput(STDOUT_FILENO)) == NULL)
+  {
+    fprintf(stderr, "ERR - Unable to allocate output buffer\n");
+    cleanup();
+    return (EXIT_FAILURE);
+  }
+
   /* setup current time updater */
   signal(SIGALRM, ctime_prog);
   alarm(ALARM_TIMER);
@@ -391,8 +508,25 @@ int main(int argc, char *argv[])
    * get to work
    */
 
+  if (config->follow)
+  {
+    /* follow until interrupted, then report as usual */
+    for (i = optind; i < argc; i++)
+    {
+      if (!validate_file_path(argv[i])) {
+        fprintf(stderr, "ERR - Invalid file path: %s\n", argv[i]);
+        cleanup();
+        return (EXIT_FAILURE);
+      }
+    }
+    signal(SIGINT, sigquit_prog);
+    signal(SIGTERM, sigquit_prog);
+    followFiles(&argv[optind], argc - optind);
+    quit = FALSE;
+  }
+
   /* process all the files */
-  while (optind < argc)
+  while (!config->follow && (optind < argc))
   {
     if (!validate_file_path(argv[optind])) {
       fprintf(stderr, "ERR - Invalid file path: %s\n", argv[optind]);
@@ -450,32 +584,50 @@ PRIVATE void print_help(void)
   fprintf(stderr, "syntax: %s [options] filename [filename ...]\n", PACKAGE);
 
 #ifdef HAVE_GETOPT_LONG
+  fprintf(stderr, " -b|--binary            -w writes a binary template database for -t\n");
+  fprintf(stderr, " -B|--bottom {num}      only show the {num} least seen templates\n");
   fprintf(stderr, " -c|--cluster           show invariable fields in output\n");
   fprintf(stderr, " -d|--debug (0-9)       enable debugging info\n");
+  fprintf(stderr, " -e|--estimate          -c with estimated distinct values of variable fields\n");
+  fprintf(stderr, " -f|--follow            follow files as they grow, print lines with new templates\n");
   fprintf(stderr, " -g|--greedy            ignore quotes\n");
   fprintf(stderr, " -h|--help              this info\n");
+  fprintf(stderr, " -H|--top {num}         only show the {num} most seen templates\n");
   fprintf(stderr, " -l|--line {line}       show all lines that match template of {line}\n");
   fprintf(stderr, " -L|--linefile {fname}  show all the lines that match templates of lines in {fname}\n");
   fprintf(stderr, " -m|--match {template}  show all lines that match {template}\n");
   fprintf(stderr, " -M|--matchfile {fname} show all the lines that match templates in {fname}\n");
   fprintf(stderr, " -n|--cnum {num}        max cluster args [default: %d]\n", MAX_ARGS_IN_FIELD);
+  fprintf(stderr, " -s|--sort {order}      sort by count, first-seen or template\n");
+  fprintf(stderr, " -S|--shape-cache       reuse the parse of lines with the same shape\n");
   fprintf(stderr, " -t|--templates {file}  load templates to ignore\n");
+  fprintf(stderr, " -T|--threads {num}     parser threads [default: 1]\n");
   fprintf(stderr, " -v|--version           display version information\n");
   fprintf(stderr, " -w|--write {file}      save templates to file\n");
+  fprintf(stderr, " -X|--teardown          free all memory before exiting (leak checking)\n");
   fprintf(stderr, " filename               one or more files to process, use '-' to read from stdin\n");
 #else
+  fprintf(stderr, " -b            -w writes a binary template database for -t\n");
+  fprintf(stderr, " -B {num}      only show the {num} least seen templates\n");
   fprintf(stderr, " -c            show invariable fields in output\n");
   fprintf(stderr, " -d {lvl}      enable debugging info\n");
+  fprintf(stderr, " -e            -c with estimated distinct values of variable fields\n");
+  fprintf(stderr, " -f            follow files as they grow, print lines with new templates\n");
   fprintf(stderr, " -g            ignore quotes\n");
   fprintf(stderr, " -h            this info\n");
+  fprintf(stderr, " -H {num}      only show the {num} most seen templates\n");
   fprintf(stderr, " -l {line}     show all lines that match template of {line}\n");
   fprintf(stderr, " -L {fname}    show all the lines that match templates of lines in {fname}\n");
   fprintf(stderr, " -m {template} show all lines that match {template}\n");
   fprintf(stderr, " -M {fname}    show all the lines that match templates in {fname}\n");
   fprintf(stderr, " -n {num}      max cluster args [default: %d]\n", MAX_ARGS_IN_FIELD);
+  fprintf(stderr, " -s {order}    sort by count, first-seen or template\n");
+  fprintf(stderr, " -S            reuse the parse of lines with the same shape\n");
   fprintf(stderr, " -t {file}     load templates to ignore\n");
+  fprintf(stderr, " -T {num}      parser threads [default: 1]\n");
   fprintf(stderr, " -v            display version information\n");
   fprintf(stderr, " -w {file}     save templates to file\n");
+  fprintf(stderr, " -X            free all memory before exiting (leak checking)\n");
   fprintf(stderr, " filename      one or more files to process, use '-' to read from stdin\n");
 #endif
 
@@ -490,14 +642,29 @@ PRIVATE void print_help(void)
 
 PRIVATE void cleanup(void)
 {
+  flushOutput(reportOut);
+  if (config->outFile_st != NULL)
+    fclose(config->outFile_st);
+
+  /*
+   * freeing millions of records one at a time can take longer than
+   * printing them, unless asked the heap goes away with the process
+   */
+  if (!config->teardown)
+  {
+    fflush(stdout);
+    return;
+  }
+
+  closeOutput(reportOut);
+
   /* free any match templates */
   cleanMatchList();
+  closeTemplateDbs();
   
   /* cleanup global string interning system */
   cleanupGlobalIntern();
 
-  if (config->outFile_st != NULL)
-    fclose(config->outFile_st);
   XFREE(config->hostname);
 #ifdef MEM_DEBUG
   XFREE_ALL();
@@ -506,6 +673,18 @@ PRIVATE void cleanup(void)
 #endif
 }
 
+/*****
+ *
+ * interrupt handler (stop following)
+ *
+ *****/
+
+void sigquit_prog(int signo)
+{
+  (void)signo;
+  quit = TRUE;
+}
+
 /*****
  *
  * interrupt handler (current time)
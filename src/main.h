@@ -53,6 +53,8 @@
 #include "util.h"
 #include "mem.h"
 #include "tmpltr.h"
+#include "pipeline.h"
+#include "follow.h"
 #include "match.h"
 #include "string_intern.h"
 
@@ -79,6 +81,7 @@ PRIVATE void print_version( void );
 PRIVATE void print_help( void );
 PRIVATE void cleanup( void );
 void ctime_prog( int signo );
+void sigquit_prog( int signo );
 
 #endif /* MAIN_DOT_H */
 
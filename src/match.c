@@ -40,7 +40,8 @@
  *
  ****/
 
-struct templateMatchList_s *matchTemplates = NULL;
+/* every -m/-M/-l/-L template, keyed on the template string */
+PRIVATE struct hash_s *matchHash = NULL;
 
 /****
  * 
@@ -110,44 +111,44 @@ PRIVATE FILE *secure_fopen(const char *path, const char *mode)
 
 /****
  *
- * add template to match list
+ * add template to the match index
  *
  ****/
 
 int addMatchTemplate(char *template)
 {
   int templateLen = strlen(template);
-  struct templateMatchList_s *head = matchTemplates;
-  struct templateMatchList_s *tmpMatch = XMALLOC(sizeof(struct templateMatchList_s));
 
 #ifdef DEBUG
   if (config->debug >= 1)
     fprintf(stderr, "Adding template to search list [%s]\n", template);
 #endif
 
-  XMEMSET(tmpMatch, 0, sizeof(struct templateMatchList_s));
   if (templateLen > MAX_FIELD_LEN)
   {
     fprintf(stderr, "ERR - Match template too long\n");
-    XFREE(tmpMatch);
     return FALSE;
   }
-  tmpMatch->template = XMALLOC(templateLen + 1);
-  XMEMSET(tmpMatch->template, 0, templateLen + 1);
-  XMEMCPY(tmpMatch->template, template, templateLen);
-  tmpMatch->len = templateLen;
-
-  if (head == NULL)
-    head = tmpMatch;
-  else
-  {
-    while (head->next != NULL)
-      head = head->next;
-    head->next = tmpMatch;
-  }
+
+  if ((matchHash == NULL) && ((matchHash = initSwissHash(MATCH_HASH_SIZE)) == NULL))
+    return FALSE;
+
+  /* keys include the nul, the same as the template hash */
+  addUniqueHashRec(matchHash, template, templateLen + 1, NULL);
+  if (matchHash->totalRecords * 4 > matchHash->size * 3)
+    matchHash = dyGrowHash(matchHash);
+
   return TRUE;
 }
 
+#ifdef DEBUG
+PRIVATE int printMatchTemplate(const struct hashRec_s *hashRec)
+{
+  printf("DEBUG - Loaded [%s]\n", hashRec->keyString);
+  return FALSE;
+}
+#endif
+
 /****
  *
  * load match templates from file
@@ -201,24 +202,13 @@ int loadMatchTemplates(char *fName)
 
 #ifdef DEBUG
   if (config->debug >= 6)
-  {
-    struct templateMatchList_s *matchPtr = matchTemplates;
-
-    printf("DEBUG - matchPtr: 0x%08lx", (unsigned long)matchPtr);
-
-    /* search templates for match */
-    while (matchPtr != NULL)
-    {
-      printf("DEBUG - Loaded [%s]\n", matchPtr->template);
-      matchPtr = matchPtr->next;
-    }
-  }
+    traverseHash(matchHash, printMatchTemplate);
 
   if (config->debug >= 1)
     printf("DEBUG - Loaded [%lu] match templates\n", count);
 #endif
 
-  return (EXIT_SUCCESS);
+  return (TRUE);
 }
 
 /****
@@ -227,18 +217,41 @@ int loadMatchTemplates(char *fName)
  *
  ****/
 
-int addMatchLine(char *line)
+PRIVATE int addParsedMatchLine(parser_ctx_t *ctx, char *line)
 {
   char oBuf[4096];
+  char *lBuf;
+  size_t lLen = strlen(line);
+  int ret = FALSE;
 
-  if (parseLine(line) > 0)
+  /* parse it with its newline, the way lines from the input are parsed */
+  lBuf = (char *)XMALLOC(lLen + 2);
+  XMEMCPY(lBuf, line, lLen);
+  lBuf[lLen] = '\n';
+  lBuf[lLen + 1] = '\0';
+
+  if (parseLine(ctx, lBuf, (int)lLen + 1) > 0)
   {
-    getParsedField(oBuf, sizeof(oBuf), 0);
+    getParsedField(ctx, oBuf, sizeof(oBuf), 0);
     addMatchTemplate(oBuf);
-    return TRUE;
+    ret = TRUE;
   }
 
-  return FALSE;
+  XFREE(lBuf);
+  return ret;
+}
+
+int addMatchLine(char *line)
+{
+  parser_ctx_t *ctx;
+  int ret;
+
+  if ((ctx = initParser()) == NULL)
+    return FALSE;
+  ret = addParsedMatchLine(ctx, line);
+  deInitParser(ctx);
+
+  return ret;
 }
 
 /****
@@ -253,6 +266,7 @@ int loadMatchLines(char *fName)
   char inBuf[65536];  /* 64KB buffer for better I/O performance */
   size_t count = 0;
   int lLen, i;
+  parser_ctx_t *ctx;
 
 #ifdef DEBUG
   if (config->debug >= 1)
@@ -265,6 +279,12 @@ int loadMatchLines(char *fName)
     return (FAILED);
   }
 
+  if ((ctx = initParser()) == NULL)
+  {
+    fclose(inFile);
+    return (FAILED);
+  }
+
   while (fgets(inBuf, sizeof(inBuf), inFile) != NULL)
   {
     if (inBuf[0] != '#')
@@ -286,10 +306,11 @@ int loadMatchLines(char *fName)
 #endif
 
       count++;
-      addMatchLine(inBuf);
+      addParsedMatchLine(ctx, inBuf);
     }
   }
 
+  deInitParser(ctx);
   fclose(inFile);
 
 #ifdef DEBUG
@@ -302,56 +323,29 @@ int loadMatchLines(char *fName)
 
 /****
  *
- * test for match
+ * test for match, template must be nul terminated at templateLen and
+ * templateHash is the hash the parser returned with it
  *
  ****/
 
-int templateMatches(char *template)
+int templateMatches(const char *template, size_t templateLen, uint64_t templateHash)
 {
-  int i, match = TRUE;
-  int templateLen = strlen(template);
-  struct templateMatchList_s *matchPtr = matchTemplates;
-
-  /* search templates for match */
-  while (matchPtr != NULL)
-  {
 #ifdef DEBUG
-    if (config->debug >= 3)
-      printf("DEBUG - Compairing [%s] to [%s]\n", template, matchPtr->template);
+  if (config->debug >= 3)
+    printf("DEBUG - Looking up [%s]\n", template);
 #endif
-    if (matchPtr->len == templateLen)
-    {
-      for (i = templateLen; match == TRUE && i >= 0; i--)
-        if (template[i] != matchPtr->template[i])
-          match = FALSE;
-      if (match == TRUE)
-        return TRUE;
-    }
-    matchPtr = matchPtr->next;
-    match = TRUE;
-  }
 
-  /* if template matches, increment match count */
-
-  return FALSE;
+  return (snoopHashRecordWithHash(matchHash, template, (int)templateLen + 1, templateHash) != NULL);
 }
 
 /****
  *
- * cleanup match list
+ * cleanup match index
  *
  ****/
 
 void cleanMatchList(void)
 {
-  struct templateMatchList_s *matchPtr;
-
-  while (matchTemplates != NULL)
-  {
-    matchPtr = matchTemplates;
-    if (matchPtr->template != NULL)
-      XFREE(matchPtr->template);
-    matchTemplates = matchTemplates->next;
-    XFREE(matchPtr);
-  }
+  freeHash(matchHash);
+  matchHash = NULL;
 }
@@ -51,19 +51,7 @@
  *
  ****/
 
-/****
- *
- * typdefs & structs
- *
- ****/
-
-struct templateMatchList_s
-{
-  char *template;
-  int len;
-  int count;
-  struct templateMatchList_s *next;
-};
+#define MATCH_HASH_SIZE 1024               /* initial match index slots */
 
 /****
  *
@@ -75,7 +63,7 @@ int addMatchTemplate(char *template);
 int loadMatchTemplates(char *fName);
 int addMatchLine(char *line);
 int loadMatchLines(char *fName);
-int templateMatches(char *template);
+int templateMatches(const char *template, size_t templateLen, uint64_t templateHash);
 void cleanMatchList(void);
 
 #endif /* end of MATCH_DOT_H */
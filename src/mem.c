@@ -896,7 +896,7 @@ void xgrow_(void **old, int elementSize, int *oldCount, int newCount, char *file
 char *xstrcpy_(char *d_ptr, const char *s_ptr, const char *filename, const int linenumber)
 {
   void *result;
-  PRIVATE int size;
+  int size;
 #ifdef MEM_DEBUG
   PRIVATE struct Mem_s *mem_ptr;
   PRIVATE int source_size;
@@ -1049,7 +1049,7 @@ char *xstrcpy_(char *d_ptr, const char *s_ptr, const char *filename, const int l
 char *xstrncpy_(char *d_ptr, const char *s_ptr, const size_t len, const char *filename, const int linenumber)
 {
   char *result;
-  PRIVATE size_t size;
+  size_t size;
 #ifdef MEM_DEBUG
   PRIVATE struct Mem_s *mem_ptr;
   PRIVATE int source_size;
@@ -0,0 +1,245 @@
+/*****
+ *
+ * Description: Buffered Output
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+/****
+ *
+ * report and match output goes through here instead of stdio
+ *
+ * pending output is a list of segments written with one writev().
+ * data that may change before the next write is copied into the
+ * output buffer, data that stays put (lines in a mapped file) is
+ * referenced where it is.  touching segments are merged, so a run of
+ * matching lines in a mapped file is written as one segment without
+ * being copied at all
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "output.h"
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * buffered writer for an open descriptor
+ *
+ ****/
+
+output_t *openOutput(int fd)
+{
+  output_t *out;
+
+  if ((out = (output_t *)XMALLOC(sizeof(output_t))) == NULL)
+    return NULL;
+  XMEMSET(out, 0, sizeof(output_t));
+  if ((out->buf = (char *)XMALLOC(OUTPUT_BUF_SIZE)) == NULL)
+  {
+    XFREE(out);
+    return NULL;
+  }
+  out->fd = fd;
+
+  return out;
+}
+
+/****
+ *
+ * write segments, picking up after short writes
+ *
+ ****/
+
+PRIVATE void writeSegments(output_t *out, struct iovec *iov, int count)
+{
+  ssize_t wCount;
+  size_t left;
+
+  while ((count > 0) && !out->failed)
+  {
+    if ((wCount = writev(out->fd, iov, count)) == -1)
+    {
+      if (errno == EINTR)
+        continue;
+      fprintf(stderr, "ERR - Write failed %d (%s)\n", errno, strerror(errno));
+      out->failed = TRUE;
+      return;
+    }
+
+    /* drop what went out, a short write can end mid segment */
+    left = (size_t)wCount;
+    while ((count > 0) && (left >= iov->iov_len))
+    {
+      left -= iov->iov_len;
+      iov++;
+      count--;
+    }
+    if (count > 0)
+    {
+      iov->iov_base = (char *)iov->iov_base + left;
+      iov->iov_len -= left;
+    }
+  }
+}
+
+/****
+ *
+ * write everything pending
+ *
+ * RETURNS:
+ *   TRUE, or FAILED once a write has failed
+ *
+ ****/
+
+int flushOutput(output_t *out)
+{
+  if (out == NULL)
+    return TRUE;
+
+  /* whatever stdio still holds was printed first */
+  if (out->fd == STDOUT_FILENO)
+    fflush(stdout);
+
+  writeSegments(out, out->iov, out->iovCount);
+  out->iovCount = 0;
+  out->bufUsed = 0;
+  out->pending = 0;
+
+  return (out->failed ? FAILED : TRUE);
+}
+
+/****
+ *
+ * queue a segment, the caller has made sure there is room for it
+ *
+ ****/
+
+PRIVATE void addSegment(output_t *out, const char *data, size_t len)
+{
+  struct iovec *last = (out->iovCount > 0) ? &out->iov[out->iovCount - 1] : NULL;
+
+  if ((last != NULL) && ((const char *)last->iov_base + last->iov_len == data))
+    last->iov_len += len;
+  else
+  {
+    /* iov_base is not const, writev() only reads it */
+    out->iov[out->iovCount].iov_base = (void *)(uintptr_t)data;
+    out->iov[out->iovCount].iov_len = len;
+    out->iovCount++;
+  }
+
+  if ((out->pending += len) >= OUTPUT_FLUSH_SIZE)
+    flushOutput(out);
+}
+
+/****
+ *
+ * copy data to the output
+ *
+ ****/
+
+void writeOutput(output_t *out, const char *data, size_t len)
+{
+  struct iovec iov;
+  char *dst;
+
+  if ((len > OUTPUT_BUF_SIZE - out->bufUsed) || (out->iovCount == OUTPUT_IOV_MAX))
+    flushOutput(out);
+
+  if (len > OUTPUT_BUF_SIZE)
+  {
+    /* nothing is pending after the flush, no need to copy */
+    iov.iov_base = (void *)(uintptr_t)data;
+    iov.iov_len = len;
+    writeSegments(out, &iov, 1);
+    return;
+  }
+
+  dst = out->buf + out->bufUsed;
+  memcpy(dst, data, len);
+  out->bufUsed += len;
+  addSegment(out, dst, len);
+}
+
+/****
+ *
+ * write data in place
+ *
+ * PRECONDITIONS:
+ *   data is not changed or released before the next flushOutput()
+ *
+ ****/
+
+void writeOutputRef(output_t *out, const char *data, size_t len)
+{
+  if (out->iovCount == OUTPUT_IOV_MAX)
+    flushOutput(out);
+  addSegment(out, data, len);
+}
+
+/****
+ *
+ * decimal value right aligned in width columns, printf("%*lu")
+ *
+ ****/
+
+void writeOutputCount(output_t *out, uint64_t value, int width)
+{
+  char digits[32];
+  char *p = digits + sizeof(digits);
+
+  do
+  {
+    *--p = (char)('0' + (value % 10));
+    value /= 10;
+  } while (value != 0);
+
+  if (width > (int)sizeof(digits))
+    width = (int)sizeof(digits);
+  while (digits + sizeof(digits) - p < (ptrdiff_t)width)
+    *--p = ' ';
+
+  writeOutput(out, p, (size_t)(digits + sizeof(digits) - p));
+}
+
+/****
+ *
+ * flush and free the writer, the descriptor is left open
+ *
+ ****/
+
+void closeOutput(output_t *out)
+{
+  if (out == NULL)
+    return;
+
+  flushOutput(out);
+  XFREE(out->buf);
+  XFREE(out);
+}
@@ -0,0 +1,96 @@
+/*****
+ *
+ * Description: Buffered Output Headers
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#ifndef OUTPUT_DOT_H
+#define OUTPUT_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+#include "mem.h"
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+#define OUTPUT_BUF_SIZE (256 * 1024)       /* copied bytes held between writes */
+#define OUTPUT_IOV_MAX 64                  /* segments handed to one writev() */
+#define OUTPUT_FLUSH_SIZE (1024 * 1024)    /* pending bytes, copied or referenced, that force a write */
+
+/****
+ *
+ * typedefs & structs
+ *
+ ****/
+
+typedef struct output_s
+{
+  int fd;
+  int failed;                   /* a write failed, later output is dropped */
+  char *buf;                    /* copies of formatted and short lived data */
+  size_t bufUsed;
+  struct iovec iov[OUTPUT_IOV_MAX]; /* pending output in order, into buf or the caller's memory */
+  int iovCount;
+  size_t pending;
+} output_t;
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+output_t *openOutput(int fd);
+void writeOutput(output_t *out, const char *data, size_t len);
+void writeOutputRef(output_t *out, const char *data, size_t len);
+void writeOutputCount(output_t *out, uint64_t value, int width);
+int flushOutput(output_t *out);
+void closeOutput(output_t *out);
+
+/****
+ *
+ * copy a nul terminated string
+ *
+ ****/
+
+static inline void writeOutputString(output_t *out, const char *str)
+{
+  writeOutput(out, str, strlen(str));
+}
+
+#endif /* OUTPUT_DOT_H */
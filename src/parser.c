@@ -40,8 +40,6 @@
  *
  ****/
 
-PRIVATE char *fields[MAX_FIELD_POS];
-
 #ifdef DEBUG
 PRIVATE size_t count_extract = 0;
 PRIVATE size_t count_string = 0;
@@ -183,58 +181,179 @@ extern Config_t *config;
 
 /****
  *
- * Initialize parser with pre-allocated field storage
+ * grow the template buffer to hold at least size bytes
+ *
+ ****/
+
+PRIVATE void growTemplate(parser_ctx_t *ctx, size_t size)
+{
+  size_t newSize = (ctx->templateSize == 0) ? PARSER_MIN_ARENA : ctx->templateSize;
+
+  while (newSize < size)
+    newSize *= 2;
+  ctx->template = (char *)XREALLOC(ctx->template, newSize);
+  ctx->templateSize = newSize;
+}
+
+/****
+ *
+ * grow the field arena to hold at least size bytes
+ *
+ * spans are offsets, so they survive the arena moving
+ *
+ ****/
+
+PRIVATE void growArena(parser_ctx_t *ctx, size_t size)
+{
+  size_t newSize = (ctx->arenaSize == 0) ? PARSER_MIN_ARENA : ctx->arenaSize;
+
+  while (newSize < size)
+    newSize *= 2;
+  ctx->arena = (char *)XREALLOC(ctx->arena, newSize);
+  ctx->arenaSize = newSize;
+}
+
+/****
+ *
+ * record a field as a span of the line being parsed, nothing is copied
+ *
+ ****/
+
+PRIVATE void growSpans(parser_ctx_t *ctx, int fieldPos)
+{
+  int newSpanSize;
+
+  newSpanSize = (ctx->spanSize == 0) ? PARSER_MIN_SPANS : ctx->spanSize * 2;
+  while (newSpanSize <= fieldPos)
+    newSpanSize *= 2;
+  if (newSpanSize > MAX_FIELD_POS)
+    newSpanSize = MAX_FIELD_POS;
+  ctx->spans = (parser_span_t *)XREALLOC(ctx->spans, sizeof(parser_span_t) * newSpanSize);
+  ctx->spanSize = newSpanSize;
+}
+
+PRIVATE int storeField(parser_ctx_t *ctx, int fieldPos, char fieldTypeChar, int start, int len)
+{
+  parser_span_t *span;
+
+  if (fieldPos >= MAX_FIELD_POS)
+  {
+    fprintf(stderr, "ERR - Too many fields in line\n");
+    return FALSE;
+  }
+
+  if (fieldPos >= ctx->spanSize)
+    growSpans(ctx, fieldPos);
+
+  span = &ctx->spans[fieldPos];
+  span->off = (uint32_t)start;
+  span->len = (uint32_t)len;
+  span->arenaOff = PARSER_NOT_MATERIALIZED;
+  span->type = fieldTypeChar;
+  ctx->fieldCount = fieldPos + 1;
+
+  return TRUE;
+}
+
+/****
+ *
+ * test whether the number at str fits in an ipv4 octet
+ *
+ * this is the only place the parser looks at digit values rather than
+ * digit positions, so the outcome is recorded for the shape cache
+ *
+ ****/
+
+PRIVATE int octetInRange(parser_ctx_t *ctx, const char *str)
+{
+  int inRange = (atoi(str) < 256);
+
+  if (ctx->guardCount < PARSER_MAX_GUARDS)
+  {
+    ctx->guards[ctx->guardCount].pos = (uint32_t)(str - ctx->line);
+    ctx->guards[ctx->guardCount].inRange = inRange;
+  }
+  ctx->guardCount++;
+
+  return inRange;
+}
+
+/****
+ *
+ * copy a field into the arena as a type prefixed, nul terminated
+ * string the first time a caller asks for it that way
+ *
+ ****/
+
+PRIVATE char *materializeField(parser_ctx_t *ctx, int fieldNum)
+{
+  parser_span_t *span = &ctx->spans[fieldNum];
+  size_t need;
+  char *dst;
+
+  if (span->arenaOff == PARSER_NOT_MATERIALIZED)
+  {
+    need = ctx->arenaUsed + span->len + 2;
+    if (need > ctx->arenaSize)
+      growArena(ctx, need);
+
+    dst = ctx->arena + ctx->arenaUsed;
+    dst[0] = span->type;
+    XMEMCPY(dst + 1, ctx->line + span->off, span->len);
+    dst[span->len + 1] = '\0';
+
+    span->arenaOff = (uint32_t)ctx->arenaUsed;
+    ctx->arenaUsed = need;
+  }
+
+  return ctx->arena + span->arenaOff;
+}
+
+/****
+ *
+ * Initialize parser context
  *
  * DESCRIPTION:
- *   Initializes the log line parser by pre-allocating memory for all
- *   field storage arrays. This optimization eliminates malloc overhead
- *   during parsing by allocating all required memory upfront.
+ *   Creates an empty parser context. Field and template storage is
+ *   allocated lazily by parseLine() and grows to fit the longest line
+ *   seen, so an idle context costs a few bytes. Each context is
+ *   independent, so one context per thread can parse concurrently.
  *
  * PARAMETERS:
  *   None
  *
  * RETURNS:
- *   void
- *
- * SIDE EFFECTS:
- *   - Allocates memory for MAX_FIELD_POS fields of MAX_FIELD_LEN each
- *   - Initializes all fields to empty strings
- *   - On allocation failure, cleans up partial allocations and exits
+ *   Pointer to new parser context on success
+ *   NULL on allocation failure
  *
  * MEMORY ALLOCATION:
- *   Allocates MAX_FIELD_POS * MAX_FIELD_LEN bytes total
- *   All fields are zero-initialized for clean state
- *
- * ERROR HANDLING:
- *   If allocation fails, frees any successfully allocated fields
- *   and logs error message before returning
+ *   One template buffer, one field arena and one span array per
+ *   context, each grown by doubling
  *
  ****/
 
-void initParser(void)
+parser_ctx_t *initParser(void)
 {
-  int i;
+  parser_ctx_t *ctx;
 
-  /* make sure the field list of clean */
-  XMEMSET(fields, 0, sizeof(char *) * MAX_FIELD_POS);
+  /* the first context picks the run scanner, before any thread is started */
+  initScanners();
 
-  /* Pre-allocate all field storage for better performance */
-  for (i = 0; i < MAX_FIELD_POS; i++)
+  if ((ctx = (parser_ctx_t *)XMALLOC(sizeof(parser_ctx_t))) == NULL)
   {
-    if ((fields[i] = (char *)XMALLOC(MAX_FIELD_LEN)) == NULL)
-    {
-      /* Cleanup partial allocation on failure */
-      for (int j = 0; j < i; j++)
-      {
-        XFREE(fields[j]);
-        fields[j] = NULL;
-      }
-      display(LOG_ERR, "Unable to pre-allocate parser field storage");
-      return;
-    }
-    /* Initialize to empty string */
-    fields[i][0] = '\0';
+    display(LOG_ERR, "Unable to allocate parser context");
+    return NULL;
+  }
+  XMEMSET(ctx, 0, sizeof(parser_ctx_t));
+
+  if (config->shapeCache)
+  {
+    ctx->shapes = (parser_shape_t *)XMALLOC(sizeof(parser_shape_t) * SHAPE_CACHE_SIZE);
+    XMEMSET(ctx->shapes, 0, sizeof(parser_shape_t) * SHAPE_CACHE_SIZE);
+    ctx->shapeBuf = (char *)XMALLOC(SHAPE_MAX_LINE);
   }
+
+  return ctx;
 }
 
 /****
@@ -242,51 +361,77 @@ void initParser(void)
  * Deinitialize parser and free field storage
  *
  * DESCRIPTION:
- *   Cleans up parser state by freeing all pre-allocated field storage
- *   memory. Should be called when parser is no longer needed to
- *   prevent memory leaks.
+ *   Cleans up parser state by freeing the template buffer, field arena,
+ *   span array, shape cache and the context itself. Should be called when parser is no
+ *   longer needed to prevent memory leaks.
  *
  * PARAMETERS:
- *   None
+ *   ctx - Parser context returned by initParser(), may be NULL
  *
  * RETURNS:
  *   void
  *
  * SIDE EFFECTS:
- *   Frees all memory allocated for field arrays in initParser()
+ *   Frees all memory allocated for the context
  *
  * PRECONDITIONS:
  *   initParser() should have been called previously
  *
  * POSTCONDITIONS:
- *   All field pointers are freed, parser is ready for re-initialization
+ *   All field storage and the context are freed, ctx must not be reused
  *
  ****/
 
-void deInitParser(void)
+void deInitParser(parser_ctx_t *ctx)
 {
   int i;
 
-  for (i = 0; i < MAX_FIELD_POS; i++)
+  if (ctx == NULL)
+    return;
+
+  if (ctx->template != NULL)
+    XFREE(ctx->template);
+  if (ctx->arena != NULL)
+    XFREE(ctx->arena);
+  if (ctx->spans != NULL)
+    XFREE(ctx->spans);
+  if (ctx->shapes != NULL)
   {
-    if (fields[i] != NULL)
-    {
-      XFREE(fields[i]);
-      fields[i] = NULL;
-    }
+#ifdef DEBUG
+    if (config->debug >= 2)
+      fprintf(stderr, "DEBUG - Shape cache hits: %lu of %lu lookups\n", (unsigned long)ctx->shapeTotalHits, (unsigned long)ctx->shapeTotalLookups);
+#endif
+    for (i = 0; i < SHAPE_CACHE_SIZE; i++)
+      if (ctx->shapes[i].spans != NULL)
+        XFREE(ctx->shapes[i].spans);
+    XFREE(ctx->shapes);
+    XFREE(ctx->shapeBuf);
   }
+  XFREE(ctx);
 }
 
 /****
  *
- * parse that line
+ * most bytes a run can take before the line ends or the field is too long
  *
- * pass a line to the function and the function will
- * return a printf style format string
+ ****/
+
+PRIVATE size_t runLimit(int lineLen, int curLinePos, int runLen)
+{
+  int limit = lineLen - curLinePos;
+
+  if (limit > MAX_FIELD_LEN - 1 - runLen)
+    limit = MAX_FIELD_LEN - 1 - runLen;
+  return (limit > 0) ? (size_t)limit : 0;
+}
+
+/****
+ *
+ * the parser state machine, see parseLine()
  *
  ****/
 
-int parseLine(char *line)
+PRIVATE int parseLineFsm(parser_ctx_t *ctx, char *line, int lineLen)
 {
   int curLinePos = 0;
   int startOfField, startOfOctet;
@@ -297,15 +442,26 @@ int parseLine(char *line)
   int templatePos = 0;
   int inQuotes = FALSE;
   char fieldTypeChar;
-  char curChar = line[0];
-  int lineLen = strlen(line);
+  char curChar = (lineLen > 0) ? line[0] : '\0';
   int base64BlockPos = 0;                /* Position within 4-byte block */
   int base64PaddingCount = 0;            /* Track '=' padding chars */
   int savedFieldType = FIELD_TYPE_UNDEF; /* For rollback */
   int hexCase = 0;                       /* 0=unset, 1=lower, 2=upper */
   int macCase = 0;                       /* 0=unset, 1=lower, 2=upper */
-
-  /* Field 0 is pre-allocated for template storage */
+  size_t scanLen;
+
+  /* size the template for this line up front, it only grows on the rare line that needs more */
+  if (ctx->templateSize < (size_t)(lineLen * 2) + 4)
+    growTemplate(ctx, (size_t)(lineLen * 2) + 4);
+  ctx->template[0] = '\0';
+  ctx->templateLen = 0;
+  ctx->templateHashed = FALSE;
+  ctx->line = line;
+  ctx->arenaUsed = 0;
+  ctx->fieldCount = 1;
+  ctx->guardCount = 0;
+
+  /* Field 0 is the template */
   fieldPos++;
 
   while (curChar != '\0')
@@ -335,108 +491,63 @@ int parseLine(char *line)
         printf("DEBUG - STATE=string\n");
 #endif
 
-      if (FAST_ISALNUM(curChar))
+      /* alnum and in-token punctuation, plus the separators between quotes, stay in the string */
+      if ((scanLen = scanRun(line + curLinePos, runLimit(lineLen, curLinePos, runLen), inQuotes ? RUN_CLASS_QUOTED : RUN_CLASS_STRING)) > 0)
       {
-        runLen++;
-        curLinePos++;
+        runLen += (int)scanLen;
+        curLinePos += (int)scanLen;
       }
-      else
+      else if (curChar == '\"')
       {
-        switch (curChar)
-        {
-        case '.':
-        case '-':
-        case '#':
-        case '$':
-        case '~':
-        case '^':
-        case '@':
-        case '%':
-        case '_':
-        case '\\':
-        case '*':
-          runLen++;
-          curLinePos++;
-          break;
-        case '\"':
-          /* check to see if it is the start or end */
+        /* check to see if it is the start or end */
 
-          if (inQuotes || config->greedy)
-          {
+        if (inQuotes || config->greedy)
+        {
 
-            /* extract string - field already pre-allocated */
-            fields[fieldPos][runLen + 1] = '\0';
-            fields[fieldPos][0] = 's';
-            XMEMCPY(fields[fieldPos] + 1, line + startOfField, runLen);
+          /* extract string */
+          if (!storeField(ctx, fieldPos, 's', startOfField, runLen))
+            return (fieldPos - 1);
 
 #ifdef DEBUG
-            if (config->debug >= 5)
-              printf("DEBUG - Extracting string [%s]\n", fields[fieldPos] + 1);
+          if (config->debug >= 5)
+            printf("DEBUG - Extracting string [%s]\n", getParsedFieldPtr(ctx, fieldPos) + 1);
 #endif
 
-            /* update template */
-            if (templatePos > (MAX_FIELD_LEN - 4))
-            {
-              fprintf(stderr, "ERR - Template is too long\n");
-              return (fieldPos - 1);
-            }
-            fields[0][templatePos++] = '%';
-            fields[0][templatePos++] = 's';
-            fields[0][templatePos++] = curChar;
-            fields[0][templatePos] = 0;
-
-            fieldPos++;
-
-            /* switch field state */
-            curFieldType = FIELD_TYPE_UNDEF;
-            runLen = 1;
-            startOfField = ++curLinePos;
-            inQuotes = FALSE;
-          }
-          else
-          {
-            /* at the start */
-            inQuotes = TRUE;
-            runLen++;
-            curLinePos++;
-          }
-
-          break;
-        case '>':
-        case '<':
-        case ',':
-        case ':':
-        case ';':
-        case '+':
-        case '!':
-        case '/':
-        case ' ':
-        case '\t':
-        case '=':
-        case '?':
-        case '{':
-        case '}':
-        case ']':
-        case '[':
-        case '\'':
-        case '`':
-        case '&':
-        case '(':
-        case ')':
-        case '\r': // to address broken input fields
-          if (inQuotes)
+          /* update template */
+          if (templatePos > (MAX_FIELD_LEN - 4))
           {
-            /* add some printable characters to the string if in quotes */
-            runLen++;
-            curLinePos++;
-            break;
+            fprintf(stderr, "ERR - Template is too long\n");
+            return (fieldPos - 1);
           }
-          __attribute__((fallthrough));
-        default:
-          /* extract field */
-          fieldTypeChar = 's';
-          curFieldType = FIELD_TYPE_EXTRACT;
+          if ((size_t)templatePos + 4 > ctx->templateSize)
+            growTemplate(ctx, (size_t)templatePos + 4);
+          ctx->template[templatePos++] = '%';
+          ctx->template[templatePos++] = 's';
+          ctx->template[templatePos++] = curChar;
+          ctx->template[templatePos] = '\0';
+          ctx->templateLen = templatePos;
+
+          fieldPos++;
+
+          /* switch field state */
+          curFieldType = FIELD_TYPE_UNDEF;
+          runLen = 1;
+          startOfField = ++curLinePos;
+          inQuotes = FALSE;
         }
+        else
+        {
+          /* at the start */
+          inQuotes = TRUE;
+          runLen++;
+          curLinePos++;
+        }
+      }
+      else
+      {
+        /* extract field */
+        fieldTypeChar = 's';
+        curFieldType = FIELD_TYPE_EXTRACT;
       }
     }
     else if (curFieldType == FIELD_TYPE_NUM_INT)
@@ -452,10 +563,10 @@ int parseLine(char *line)
 #endif
 
       /* Check for digits first to continue in NUM_INT state */
-      if (FAST_ISDIGIT(curChar))
+      if ((scanLen = scanRun(line + curLinePos, runLimit(lineLen, curLinePos, runLen), RUN_CLASS_DIGIT)) > 0)
       {
-        runLen++;
-        curLinePos++;
+        runLen += (int)scanLen;
+        curLinePos += (int)scanLen;
       }
       else if (FAST_ISXDIGIT(curChar))
       {
@@ -471,8 +582,7 @@ int parseLine(char *line)
         {
         case '.':
           if ((runLen <= 3) &&
-              (atoi(line + startOfField) <
-               256))
+              octetInRange(ctx, line + startOfField))
           { /* check to see if this is the start of an IP address */
 
             /* convert field to IPv4 */
@@ -504,7 +614,7 @@ int parseLine(char *line)
               {
                 if (line[curLinePos + 9] == ':')
                 {
-                  if (line[curLinePos + 12] == ':')
+                  if ((curLinePos + 12 < lineLen) && (line[curLinePos + 12] == ':'))
                   {
                     curFieldType = FIELD_TYPE_DT;
                     runLen++;
@@ -785,17 +895,8 @@ int parseLine(char *line)
       if (config->debug >= 9)
         printf("DEBUG - STATE=extract\n");
 #endif
-      if (fields[fieldPos] == NULL)
-      {
-        if ((fields[fieldPos] = (char *)XMALLOC(MAX_FIELD_LEN)) == NULL)
-        {
-          fprintf(stderr, "ERR - Unable to allocate memory for string\n");
-          return (fieldPos - 1);
-        }
-      }
-      fields[fieldPos][runLen + 1] = '\0';
-      fields[fieldPos][0] = fieldTypeChar;
-      XMEMCPY(fields[fieldPos] + 1, line + startOfField, runLen);
+      if (!storeField(ctx, fieldPos, fieldTypeChar, startOfField, runLen))
+        return (fieldPos - 1);
 
 #ifdef DEBUG
       if (config->debug >= 5)
@@ -803,41 +904,41 @@ int parseLine(char *line)
         switch (fieldTypeChar)
         {
         case 's':
-          printf("DEBUG - Extracted string [%s]\n", fields[fieldPos] + 1);
+          printf("DEBUG - Extracted string [%s]\n", getParsedFieldPtr(ctx, fieldPos) + 1);
           break;
         case 'd':
-          printf("DEBUG - Extracted number [%s]\n", fields[fieldPos] + 1);
+          printf("DEBUG - Extracted number [%s]\n", getParsedFieldPtr(ctx, fieldPos) + 1);
           break;
         case 'f':
-          printf("DEBUG - Extracted float [%s]\n", fields[fieldPos] + 1);
+          printf("DEBUG - Extracted float [%s]\n", getParsedFieldPtr(ctx, fieldPos) + 1);
           break;
         case 'c':
-          printf("DEBUG - Extracted character [%s]\n", fields[fieldPos] + 1);
+          printf("DEBUG - Extracted character [%s]\n", getParsedFieldPtr(ctx, fieldPos) + 1);
           break;
         case 'i':
-          printf("DEBUG - Extracted ipv4 [%s]\n", fields[fieldPos] + 1);
+          printf("DEBUG - Extracted ipv4 [%s]\n", getParsedFieldPtr(ctx, fieldPos) + 1);
           break;
         case 'I':
-          printf("DEBUG - Extracted ipv6 [%s]\n", fields[fieldPos] + 1);
+          printf("DEBUG - Extracted ipv6 [%s]\n", getParsedFieldPtr(ctx, fieldPos) + 1);
           break;
         case 'm':
-          printf("DEBUG - Extracted MAC [%s]\n", fields[fieldPos] + 1);
+          printf("DEBUG - Extracted MAC [%s]\n", getParsedFieldPtr(ctx, fieldPos) + 1);
           break;
         case 'x':
-          printf("DEBUG - Extracted hex [%s]\n", fields[fieldPos] + 1);
+          printf("DEBUG - Extracted hex [%s]\n", getParsedFieldPtr(ctx, fieldPos) + 1);
           break;
         case 't':
-          printf("DEBUG - Extracted date [%s]\n", fields[fieldPos] + 1);
+          printf("DEBUG - Extracted date [%s]\n", getParsedFieldPtr(ctx, fieldPos) + 1);
           break;
         case 'D':
-          printf("DEBUG - Extracted syslog date [%s]\n", fields[fieldPos] + 1);
+          printf("DEBUG - Extracted syslog date [%s]\n", getParsedFieldPtr(ctx, fieldPos) + 1);
           break;
         case 'b':
-          printf("DEBUG - Extracted base64 [%s]\n", fields[fieldPos] + 1);
+          printf("DEBUG - Extracted base64 [%s]\n", getParsedFieldPtr(ctx, fieldPos) + 1);
           break;
         default:
           printf("DEBUG - Extracted unknown [%c] - [%s]\n", fieldTypeChar,
-                 fields[fieldPos]);
+                 getParsedFieldPtr(ctx, fieldPos));
           break;
         }
       }
@@ -849,9 +950,12 @@ int parseLine(char *line)
         fprintf(stderr, "ERR - Template is too long\n");
         return (fieldPos - 1);
       }
-      fields[0][templatePos++] = '%';
-      fields[0][templatePos++] = fieldTypeChar;
-      fields[0][templatePos] = '\0';
+      if ((size_t)templatePos + 3 > ctx->templateSize)
+        growTemplate(ctx, (size_t)templatePos + 3);
+      ctx->template[templatePos++] = '%';
+      ctx->template[templatePos++] = fieldTypeChar;
+      ctx->template[templatePos] = '\0';
+      ctx->templateLen = templatePos;
       fieldPos++;
 
       /* switch field state */
@@ -879,7 +983,7 @@ int parseLine(char *line)
       else if (curChar == '.')
       {
         if ((octet < 3) && (octetLen > 0) && (octetLen <= 3) &&
-            (atoi(line + startOfOctet) < 256))
+            octetInRange(ctx, line + startOfOctet))
         { /* is the octet valid */
           runLen++;
           startOfOctet = ++curLinePos;
@@ -900,7 +1004,7 @@ int parseLine(char *line)
       else if (octet == 3)
       {
         if ((octetLen > 0) && (octetLen <= 3) &&
-            (atoi(line + startOfOctet) < 256))
+            octetInRange(ctx, line + startOfOctet))
         { /* is the octet valid */
 
           /* extract field */
@@ -1494,7 +1598,7 @@ int parseLine(char *line)
           else if (savedFieldType == FIELD_TYPE_NUM_INT && curChar == '.')
           {
             /* Check for IPv4 when NUM_INT encounters '.' - same logic as NUM_INT state */
-            if ((runLen <= 3) && (atoi(line + startOfField) < 256))
+            if ((runLen <= 3) && octetInRange(ctx, line + startOfField))
             {
               /* Valid start of IPv4 address */
               curFieldType = FIELD_TYPE_IP4;
@@ -1524,7 +1628,7 @@ int parseLine(char *line)
                 {
                   if (line[curLinePos + 9] == ':')
                   {
-                    if (line[curLinePos + 12] == ':')
+                    if ((curLinePos + 12 < lineLen) && (line[curLinePos + 12] == ':'))
                     {
                       curFieldType = FIELD_TYPE_DT;
                       runLen++;
@@ -1698,7 +1802,7 @@ int parseLine(char *line)
         {
 #ifdef DEBUG
           if (config->debug >= 3)
-            printf("*** SYSLOG DATE DETECTED at pos %d: %.20s ***\n", curLinePos, line + curLinePos);
+            printf("*** SYSLOG DATE DETECTED at pos %d: %.*s ***\n", curLinePos, (lineLen - curLinePos < 20) ? lineLen - curLinePos : 20, line + curLinePos);
 #endif
           curFieldType = FIELD_TYPE_DT_SYSLOG;
           runLen = 1;
@@ -1794,8 +1898,11 @@ int parseLine(char *line)
             fprintf(stderr, "ERR - Template is too long\n");
             return (fieldPos - 1);
           }
-          fields[0][templatePos++] = curChar;
-          fields[0][templatePos] = '\0';
+          if ((size_t)templatePos + 2 > ctx->templateSize)
+            growTemplate(ctx, (size_t)templatePos + 2);
+          ctx->template[templatePos++] = curChar;
+          ctx->template[templatePos] = '\0';
+          ctx->templateLen = templatePos;
           curFieldType = FIELD_TYPE_STRING;
           macCase = 0; /* Reset mac case */
           inQuotes = TRUE;
@@ -1810,11 +1917,14 @@ int parseLine(char *line)
             fprintf(stderr, "ERR - Template is too long\n");
             return (fieldPos - 1);
           }
-          fields[0][templatePos++] = curChar;
-          fields[0][templatePos] = '\0';
+          if ((size_t)templatePos + 2 > ctx->templateSize)
+            growTemplate(ctx, (size_t)templatePos + 2);
+          ctx->template[templatePos++] = curChar;
+          ctx->template[templatePos] = '\0';
+          ctx->templateLen = templatePos;
 #ifdef DEBUG
           if (config->debug >= 10)
-            printf("DEBUG - Updated template [%s]\n", fields[0]);
+            printf("DEBUG - Updated template [%s]\n", ctx->template);
 #endif
           runLen = 1;
           startOfField = curLinePos++;
@@ -1842,11 +1952,14 @@ int parseLine(char *line)
         fprintf(stderr, "ERR - Template is too long\n");
         return (fieldPos - 1);
       }
-      fields[0][templatePos++] = curChar;
-      fields[0][templatePos] = '\0';
+      if ((size_t)templatePos + 2 > ctx->templateSize)
+        growTemplate(ctx, (size_t)templatePos + 2);
+      ctx->template[templatePos++] = curChar;
+      ctx->template[templatePos] = '\0';
+      ctx->templateLen = templatePos;
 #ifdef DEBUG
       if (config->debug >= 10)
-        printf("DEBUG - Updated template [%s]\n", fields[0]);
+        printf("DEBUG - Updated template [%s]\n", ctx->template);
 #endif
       runLen = 1;
       startOfField = curLinePos++;
@@ -1857,7 +1970,8 @@ int parseLine(char *line)
       curLinePos++;
     }
   }
-  curChar = line[curLinePos];
+  /* line need not be nul terminated, stop at lineLen */
+  curChar = (curLinePos < lineLen) ? line[curLinePos] : '\0';
 }
 
 /* Handle any incomplete field at end of line */
@@ -1905,17 +2019,8 @@ if (curFieldType == FIELD_TYPE_BASE64)
 /* Extract any pending field at end of line */
 if (curFieldType == FIELD_TYPE_EXTRACT)
 {
-  if (fields[fieldPos] == NULL)
-  {
-    if ((fields[fieldPos] = (char *)XMALLOC(MAX_FIELD_LEN)) == NULL)
-    {
-      fprintf(stderr, "ERR - Unable to allocate memory for string\n");
-      return (fieldPos - 1);
-    }
-  }
-  fields[fieldPos][runLen + 1] = '\0';
-  fields[fieldPos][0] = fieldTypeChar;
-  XMEMCPY(fields[fieldPos] + 1, line + startOfField, runLen);
+  if (!storeField(ctx, fieldPos, fieldTypeChar, startOfField, runLen))
+    return (fieldPos - 1);
 
   /* update template */
   if (templatePos > (MAX_FIELD_LEN - 3))
@@ -1923,9 +2028,12 @@ if (curFieldType == FIELD_TYPE_EXTRACT)
     fprintf(stderr, "ERR - Template is too long\n");
     return (fieldPos - 1);
   }
-  fields[0][templatePos++] = '%';
-  fields[0][templatePos++] = fieldTypeChar;
-  fields[0][templatePos] = '\0';
+  if ((size_t)templatePos + 3 > ctx->templateSize)
+    growTemplate(ctx, (size_t)templatePos + 3);
+  ctx->template[templatePos++] = '%';
+  ctx->template[templatePos++] = fieldTypeChar;
+  ctx->template[templatePos] = '\0';
+  ctx->templateLen = templatePos;
   fieldPos++;
 }
 
@@ -1936,34 +2044,238 @@ if (curLinePos == 0)
 return (fieldPos);
 }
 
+/****
+ *
+ * fold the digits of a line into its shape, returns the shape hash
+ *
+ * works a word at a time: a byte is a digit when it xor '0' is below
+ * 10, the test is done on all eight bytes at once without carries
+ * crossing between them
+ *
+ ****/
+
+#define SHAPE_ONES 0x0101010101010101ULL
+#define SHAPE_HIGH 0x8080808080808080ULL
+#define SHAPE_MIX 0x9e3779b97f4a7c15ULL
+
+PRIVATE uint32_t lineShape(char *shape, const char *line, int lineLen)
+{
+  uint64_t hash = (uint64_t)lineLen * SHAPE_MIX;
+  uint64_t chunk, x, digits;
+  int i;
+
+  for (i = 0; i + 8 <= lineLen; i += 8)
+  {
+    memcpy(&chunk, line + i, sizeof(chunk));
+    x = chunk ^ (SHAPE_ONES * '0');
+    digits = ~(((x & ~SHAPE_HIGH) + (SHAPE_ONES * (0x80 - 10))) | x) & SHAPE_HIGH;
+    digits = (digits >> 7) * 0xff;
+    chunk = (chunk & ~digits) | ((SHAPE_ONES * '0') & digits);
+    memcpy(shape + i, &chunk, sizeof(chunk));
+    hash = (hash ^ chunk) * SHAPE_MIX;
+    hash ^= hash >> 29;
+  }
+  for (; i < lineLen; i++)
+  {
+    shape[i] = FAST_ISDIGIT(line[i]) ? '0' : line[i];
+    hash = (hash ^ (uint8_t)shape[i]) * SHAPE_MIX;
+  }
+  hash ^= hash >> 32;
+
+  return (uint32_t)hash;
+}
+
+/****
+ *
+ * hashKey() of the template and its nul, the form it is stored in as a
+ * hash key.  hashed once per line, cached parses bring theirs along
+ *
+ ****/
+
+PRIVATE uint64_t hashTemplate(parser_ctx_t *ctx)
+{
+  if (!ctx->templateHashed)
+  {
+    ctx->templateHash = hashKey(ctx->template, (int)ctx->templateLen + 1);
+    ctx->templateHashed = TRUE;
+  }
+  return ctx->templateHash;
+}
+
+/****
+ *
+ * save the result of the parse that just ran on line under its shape
+ *
+ ****/
+
+PRIVATE void storeShape(parser_ctx_t *ctx, parser_shape_t *slot, uint32_t hash, int lineLen, int ret)
+{
+  size_t spanBytes, guardBytes;
+  size_t i;
+
+  /* a digit kept in the template would differ between lines of one shape */
+  for (i = 0; i < ctx->templateLen; i++)
+    if (FAST_ISDIGIT(ctx->template[i]))
+      return;
+
+  if (slot->spans != NULL)
+    XFREE(slot->spans);
+
+  /* spans, guards, shape and template share one allocation */
+  spanBytes = sizeof(parser_span_t) * (size_t)ctx->fieldCount;
+  guardBytes = sizeof(parser_guard_t) * (size_t)ctx->guardCount;
+  slot->spans = (parser_span_t *)XMALLOC(spanBytes + guardBytes + (size_t)lineLen + ctx->templateLen + 1);
+  slot->guards = (parser_guard_t *)(slot->spans + ctx->fieldCount);
+  slot->shape = (char *)(slot->guards + ctx->guardCount);
+  slot->template = slot->shape + lineLen;
+
+  XMEMCPY(slot->spans, ctx->spans, spanBytes);
+  for (i = 1; i < (size_t)ctx->fieldCount; i++)
+    slot->spans[i].arenaOff = PARSER_NOT_MATERIALIZED;
+  XMEMCPY(slot->guards, ctx->guards, guardBytes);
+  XMEMCPY(slot->shape, ctx->shapeBuf, (size_t)lineLen);
+  XMEMCPY(slot->template, ctx->template, ctx->templateLen + 1);
+
+  slot->hash = hash;
+  slot->lineLen = lineLen;
+  slot->ret = ret;
+  slot->fieldCount = ctx->fieldCount;
+  slot->guardCount = ctx->guardCount;
+  slot->templateLen = ctx->templateLen;
+  slot->templateHash = hashTemplate(ctx);
+}
+
+/****
+ *
+ * load a cached parse into ctx for line
+ *
+ ****/
+
+PRIVATE int loadShape(parser_ctx_t *ctx, const parser_shape_t *slot, char *line)
+{
+  if (ctx->templateSize < slot->templateLen + 1)
+    growTemplate(ctx, slot->templateLen + 1);
+  XMEMCPY(ctx->template, slot->template, slot->templateLen + 1);
+  ctx->templateLen = slot->templateLen;
+  ctx->templateHash = slot->templateHash;
+  ctx->templateHashed = TRUE;
+
+  if (slot->fieldCount > ctx->spanSize)
+    growSpans(ctx, slot->fieldCount - 1);
+  XMEMCPY(ctx->spans, slot->spans, sizeof(parser_span_t) * (size_t)slot->fieldCount);
+
+  ctx->line = line;
+  ctx->arenaUsed = 0;
+  ctx->fieldCount = slot->fieldCount;
+
+  return slot->ret;
+}
+
+/****
+ *
+ * parse that line
+ *
+ * pass a line and its length to the function and the function will
+ * return a printf style format string in field 0 of ctx, the line
+ * does not need to be nul terminated but must stay unchanged while
+ * its fields are in use
+ *
+ * with -S each line is first reduced to its shape, the line with every
+ * digit replaced by '0'.  the state machine only branches on digit
+ * positions, apart from the ipv4 octet tests, so lines of one shape
+ * parse the same way whenever those tests come out the same.  a shape
+ * seen twice is cached with its octet test outcomes, later lines of
+ * that shape replay the cached template and field spans after
+ * rechecking the octets.  anything else takes the full parse.
+ *
+ ****/
+
+int parseLine(parser_ctx_t *ctx, char *line, int lineLen)
+{
+  parser_shape_t *slot;
+  uint32_t hash;
+  int i, ret;
+
+  /* bytes past an unterminated line could change the octet tests */
+  if ((ctx->shapes == NULL) || (lineLen <= 0) || (lineLen > SHAPE_MAX_LINE) || (line[lineLen - 1] != '\n'))
+    return parseLineFsm(ctx, line, lineLen);
+
+  /* logs with few repeating shapes only pay for the lookups, back off */
+  if (ctx->shapeBypass > 0)
+  {
+    ctx->shapeBypass--;
+    return parseLineFsm(ctx, line, lineLen);
+  }
+  if (++ctx->shapeLookups == SHAPE_WINDOW)
+  {
+    if (ctx->shapeHits < SHAPE_WINDOW / 4)
+      ctx->shapeBypass = SHAPE_WINDOW * SHAPE_BACKOFF;
+    ctx->shapeLookups = ctx->shapeHits = 0;
+  }
+
+  hash = lineShape(ctx->shapeBuf, line, lineLen);
+  slot = &ctx->shapes[hash & (SHAPE_CACHE_SIZE - 1)];
+#ifdef DEBUG
+  ctx->shapeTotalLookups++;
+#endif
+
+  if ((slot->spans != NULL) && (slot->hash == hash) && (slot->lineLen == lineLen) &&
+      (XMEMCMP(slot->shape, ctx->shapeBuf, (size_t)lineLen) == 0))
+  {
+    for (i = 0; i < slot->guardCount; i++)
+      if ((atoi(line + slot->guards[i].pos) < 256) != slot->guards[i].inRange)
+        break;
+    if (i == slot->guardCount)
+    {
+      ctx->shapeHits++;
+#ifdef DEBUG
+      ctx->shapeTotalHits++;
+#endif
+      return loadShape(ctx, slot, line);
+    }
+  }
+
+  ret = parseLineFsm(ctx, line, lineLen);
+
+  /* only shapes that repeat earn a slot, one-off lines just mark it */
+  if ((slot->pending == hash) && (ret > 0) && (ctx->guardCount <= PARSER_MAX_GUARDS))
+    storeShape(ctx, slot, hash, lineLen, ret);
+  slot->pending = hash;
+
+  return ret;
+}
+
 /****
  *
  * return parsed field
  *
  ****/
 
-int getParsedField(char *oBuf, int oBufLen, const unsigned int fieldNum)
+int getParsedField(parser_ctx_t *ctx, char *oBuf, int oBufLen, const unsigned int fieldNum)
 {
-  if ((fieldNum >= MAX_FIELD_POS) || (fields[fieldNum] == NULL))
+  if ((fieldNum >= (unsigned int)ctx->fieldCount) || (ctx->template == NULL))
   {
     fprintf(stderr, "ERR - Requested field does not exist [%d]\n", fieldNum);
     oBuf[0] = 0;
     return (FAILED);
   }
-  XSTRNCPY(oBuf, fields[fieldNum], oBufLen);
+  XSTRNCPY(oBuf, (fieldNum == 0) ? ctx->template : materializeField(ctx, fieldNum), oBufLen);
   return (TRUE);
 }
 
 /****
  *
- * Get direct pointer to parsed field (no copy)
+ * Get direct pointer to parsed field
  *
  * DESCRIPTION:
- *   Returns a direct pointer to the parsed field data without copying.
- *   This is much more efficient than getParsedField when the caller
- *   only needs to read the field data and doesn't need a separate copy.
+ *   Returns a pointer to the type prefixed, nul terminated field.
+ *   Fields are stored as spans of the input line, the first request
+ *   for a field copies it once into the context arena. Callers that
+ *   can work on (pointer, length) pairs should use
+ *   getParsedFieldSpan() instead.
  *
  * PARAMETERS:
+ *   ctx - Parser context the line was parsed with
  *   fieldNum - Index of field to retrieve (0 = template)
  *
  * RETURNS:
@@ -1971,23 +2283,76 @@ int getParsedField(char *oBuf, int oBufLen, const unsigned int fieldNum)
  *   NULL if field doesn't exist or is out of bounds
  *
  * SIDE EFFECTS:
- *   None - just returns existing pointer
+ *   May copy the field into the context arena, the pointer is valid
+ *   until the next parseLine() on ctx
  *
  * SECURITY FEATURES:
- *   - Validates field index against MAX_FIELD_POS
+ *   - Validates field index against the fields of the last parsed line
  *   - Returns const pointer to prevent modification
  *
  * PERFORMANCE:
- *   O(1) - Direct array access with no string copying
+ *   O(1) after the first request for a field
  *
  ****/
-const char *getParsedFieldPtr(const unsigned int fieldNum)
+const char *getParsedFieldPtr(parser_ctx_t *ctx, const unsigned int fieldNum)
 {
-  if ((fieldNum >= MAX_FIELD_POS) || (fields[fieldNum] == NULL))
+  if ((fieldNum >= (unsigned int)ctx->fieldCount) || (ctx->template == NULL))
   {
     return NULL;
   }
-  return fields[fieldNum];
+  if (fieldNum == 0)
+    return ctx->template;
+  return materializeField(ctx, fieldNum);
+}
+
+/****
+ *
+ * Get parsed field as a span of the input line (zero copy)
+ *
+ * DESCRIPTION:
+ *   Fills field with the type token, a pointer into the line passed to
+ *   parseLine() and the value length. Nothing is copied and the value
+ *   is not nul terminated. Field 0 is the template, which is nul
+ *   terminated, has a type of 0 and carries the hashKey() of its
+ *   bytes and nul, computed once per line however often it is asked for.
+ *
+ * PARAMETERS:
+ *   ctx - Parser context the line was parsed with
+ *   fieldNum - Index of field to retrieve (0 = template)
+ *   field - Filled in on success
+ *
+ * RETURNS:
+ *   TRUE on success
+ *   FAILED if field doesn't exist
+ *
+ * SIDE EFFECTS:
+ *   None, spans stay valid until the next parseLine() on ctx or until
+ *   the caller modifies the line buffer
+ *
+ ****/
+int getParsedFieldSpan(parser_ctx_t *ctx, const unsigned int fieldNum, parser_field_t *field)
+{
+  parser_span_t *span;
+
+  if ((fieldNum >= (unsigned int)ctx->fieldCount) || (ctx->template == NULL))
+    return (FAILED);
+
+  if (fieldNum == 0)
+  {
+    field->type = 0;
+    field->ptr = ctx->template;
+    field->len = ctx->templateLen;
+    field->hash = hashTemplate(ctx);
+  }
+  else
+  {
+    span = &ctx->spans[fieldNum];
+    field->type = span->type;
+    field->ptr = ctx->line + span->off;
+    field->len = span->len;
+  }
+
+  return (TRUE);
 }
 
 /****
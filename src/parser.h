@@ -42,6 +42,8 @@
 #include "../include/common.h"
 #include "util.h"
 #include "mem.h"
+#include "hash.h"
+#include "scan.h"
 
 /****
  *
@@ -102,23 +104,108 @@
 #define MAX_FIELD_POS 4096
 #define MAX_FIELD_LEN 32768
 
+/* initial context storage, grown on demand */
+#define PARSER_MIN_ARENA 1024
+#define PARSER_MIN_SPANS 64
+
+/* span has not been copied into the arena yet */
+#define PARSER_NOT_MATERIALIZED 0xffffffff
+
+/* line shape cache (-S) */
+#define SHAPE_CACHE_SIZE 8192    /* direct mapped slots per context, a power of two */
+#define SHAPE_MAX_LINE 4096      /* longer lines always take the full parse */
+#define SHAPE_WINDOW 65536       /* lookups between hit rate checks */
+#define SHAPE_BACKOFF 16         /* windows to bypass the cache after a poor one */
+#define PARSER_MAX_GUARDS 32     /* value checks a cached shape can carry */
+
 /****
  *
  * typdefs & structs
  *
  ****/
 
+/* location of one extracted field in the parsed line */
+typedef struct
+{
+  uint32_t off;                 /* value offset in the line */
+  uint32_t len;                 /* value length */
+  uint32_t arenaOff;            /* prefixed copy in the arena or PARSER_NOT_MATERIALIZED */
+  char type;                    /* FIELD_TYPE_*_TOK */
+} parser_span_t;
+
+/* one digit value decision taken while parsing, replayed on a shape hit */
+typedef struct
+{
+  uint32_t pos;                 /* offset of the number in the line */
+  int inRange;                  /* outcome of the octet (< 256) test */
+} parser_guard_t;
+
+/* parse result of a line shape, the line with its digits folded to '0' */
+typedef struct
+{
+  uint32_t hash;                /* of the shape, see lineShape() */
+  uint32_t pending;             /* shape seen once, cached on its next miss */
+  int lineLen;
+  int ret;                      /* parseLine() return */
+  int fieldCount;
+  int guardCount;
+  size_t templateLen;
+  uint64_t templateHash;
+  parser_span_t *spans;         /* one allocation, NULL for an empty slot */
+  parser_guard_t *guards;
+  char *shape;
+  char *template;
+} parser_shape_t;
+
+/* zero copy view of one field */
+typedef struct
+{
+  char type;                    /* FIELD_TYPE_*_TOK, 0 for the template */
+  const char *ptr;              /* into the parsed line, not nul terminated */
+  size_t len;
+  uint64_t hash;                /* template only, hashKey() of ptr and its nul */
+} parser_field_t;
+
+/* parser state, one per concurrent parse */
+typedef struct parser_ctx_s
+{
+  char *template;               /* field 0, the generated template */
+  size_t templateSize;
+  size_t templateLen;
+  uint64_t templateHash;        /* hashKey() of the template and its nul */
+  int templateHashed;           /* templateHash is set for this line */
+  char *line;                   /* line the spans point into */
+  char *arena;                  /* fields copied out on request */
+  size_t arenaSize;
+  size_t arenaUsed;
+  parser_span_t *spans;         /* spans[n] locates field n, spans[0] unused */
+  int spanSize;
+  int fieldCount;               /* fields of the current line, template included */
+  parser_guard_t guards[PARSER_MAX_GUARDS];
+  int guardCount;               /* may pass PARSER_MAX_GUARDS, the line is then not cached */
+  parser_shape_t *shapes;       /* shape cache, NULL unless -S */
+  char *shapeBuf;               /* shape of the current line */
+  int shapeLookups;             /* in the current window */
+  int shapeHits;
+  int shapeBypass;              /* lines left to parse without the cache */
+#ifdef DEBUG
+  size_t shapeTotalHits;
+  size_t shapeTotalLookups;
+#endif
+} parser_ctx_t;
+
 /****
  *
  * function prototypes
  *
  ****/
 
-void initParser(void);
-void deInitParser(void);
-int parseLine(char *line);
-int getParsedField(char *oBuf, int oBufLen, const unsigned int fieldNum);
-const char *getParsedFieldPtr(const unsigned int fieldNum);
+parser_ctx_t *initParser(void);
+void deInitParser(parser_ctx_t *ctx);
+int parseLine(parser_ctx_t *ctx, char *line, int lineLen);
+int getParsedField(parser_ctx_t *ctx, char *oBuf, int oBufLen, const unsigned int fieldNum);
+const char *getParsedFieldPtr(parser_ctx_t *ctx, const unsigned int fieldNum);
+int getParsedFieldSpan(parser_ctx_t *ctx, const unsigned int fieldNum, parser_field_t *field);
 void showCounts( void );
 
 #endif /* end of PARSER_DOT_H */
@@ -44,9 +44,10 @@ PRIVATE ParserInterface parser = {
     .parseLine = parseLine,
     .getParsedField = getParsedField,
     .getParsedFieldPtr = getParsedFieldPtr,
+    .getParsedFieldSpan = getParsedFieldSpan,
     .showCounts = showCounts,
     .supports_streaming = 0,
-    .supports_zero_copy = 0,
+    .supports_zero_copy = 1,
     .supports_aggregation = 0
 };
 
@@ -97,3 +98,29 @@ const char* getParserName(ParserType type)
     return iface ? iface->name : "unknown";
 }
 
+int getParserField(ParserInterface *iface, parser_ctx_t *ctx, const unsigned int fieldNum, parser_field_t *field)
+{
+    const char *value;
+
+    if (iface->supports_zero_copy) {
+        return iface->getParsedFieldSpan(ctx, fieldNum, field);
+    }
+
+    /* fall back to the nul terminated, type prefixed copy */
+    if ((value = iface->getParsedFieldPtr(ctx, fieldNum)) == NULL) {
+        return FAILED;
+    }
+    if (fieldNum == 0) {
+        field->type = 0;
+    } else {
+        field->type = *value++;
+    }
+    field->ptr = value;
+    field->len = strlen(value);
+    if (fieldNum == 0) {
+        field->hash = hashKey(value, (int)field->len + 1);
+    }
+
+    return TRUE;
+}
+
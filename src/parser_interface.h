@@ -40,6 +40,7 @@
 #endif
 
 #include "../include/common.h"
+#include "parser.h"
 
 /****
  *
@@ -62,17 +63,18 @@ typedef struct {
     ParserType type;
     const char* name;
     
-    /* Core parser functions */
-    void (*init)(void);
-    void (*deinit)(void);
-    int (*parseLine)(char *line);
-    int (*getParsedField)(char *oBuf, int oBufLen, const unsigned int fieldNum);
-    const char* (*getParsedFieldPtr)(const unsigned int fieldNum);
+    /* Core parser functions, init() returns a context for the others */
+    parser_ctx_t* (*init)(void);
+    void (*deinit)(parser_ctx_t *ctx);
+    int (*parseLine)(parser_ctx_t *ctx, char *line, int lineLen);
+    int (*getParsedField)(parser_ctx_t *ctx, char *oBuf, int oBufLen, const unsigned int fieldNum);
+    const char* (*getParsedFieldPtr)(parser_ctx_t *ctx, const unsigned int fieldNum);
+    int (*getParsedFieldSpan)(parser_ctx_t *ctx, const unsigned int fieldNum, parser_field_t *field);
     void (*showCounts)(void);
     
     /* Parser-specific capabilities */
     int supports_streaming;
-    int supports_zero_copy;
+    int supports_zero_copy;      /* getParsedFieldSpan() is available */
     int supports_aggregation;
 } ParserInterface;
 
@@ -94,4 +96,7 @@ ParserType getParserTypeFromString(const char* name);
 /* Get parser name from type */
 const char* getParserName(ParserType type);
 
+/* Get a field without its type prefix, zero copy when the parser supports it */
+int getParserField(ParserInterface *iface, parser_ctx_t *ctx, const unsigned int fieldNum, parser_field_t *field);
+
 #endif /* PARSER_INTERFACE_DOT_H */
\ No newline at end of file
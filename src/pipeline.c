@@ -0,0 +1,788 @@
+/*****
+ *
+ * Description: Multi-threaded Map/Merge Pipeline Functions
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "pipeline.h"
+
+#ifdef HAVE_PTHREAD_H
+
+/****
+ *
+ * local typedefs & structs
+ *
+ ****/
+
+/* bounded queue of line batches between the reader and the workers */
+struct batchQueue_s
+{
+  pthread_mutex_t lock;
+  pthread_cond_t notEmpty;
+  pthread_cond_t notFull;
+  struct lineBatch_s *head;
+  struct lineBatch_s *tail;
+  struct lineBatch_s *freeList;
+  int depth;
+  int maxDepth;
+  int done;
+};
+
+struct worker_s
+{
+  pthread_t thread;
+  int started;
+  struct batchQueue_s *queue;
+  char *rangeStart;                        /* byte range of a mapped file */
+  size_t rangeLen;
+  uint64_t rangeOff;                       /* offset of rangeStart in the file */
+  ParserInterface *parser;
+  parser_ctx_t *ctx;
+  struct hash_s *hash;
+  string_intern_t *intern;
+};
+
+/****
+ *
+ * local variables
+ *
+ ****/
+
+/* traverseHash() callbacks take no context, merge state lives here */
+PRIVATE struct hash_s *mergeHash = NULL;
+
+/****
+ *
+ * external variables
+ *
+ ****/
+
+extern Config_t *config;
+extern int quit;
+extern int reload;
+extern struct hash_s *templateHash;
+extern uint64_t inputSeq;
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * get an empty batch, reusing one a worker has released if possible
+ *
+ ****/
+
+PRIVATE struct lineBatch_s *getFreeBatch(struct batchQueue_s *queue)
+{
+  struct lineBatch_s *batch;
+
+  pthread_mutex_lock(&queue->lock);
+  if ((batch = queue->freeList) != NULL)
+    queue->freeList = batch->next;
+  pthread_mutex_unlock(&queue->lock);
+
+  if (batch == NULL)
+  {
+    batch = (struct lineBatch_s *)XMALLOC(sizeof(struct lineBatch_s));
+    batch->buf = (char *)XMALLOC(PIPELINE_BATCH_SIZE);
+  }
+
+  batch->used = 0;
+  batch->lineCount = 0;
+  batch->firstSeq = 0;
+  batch->next = NULL;
+
+  return batch;
+}
+
+/****
+ *
+ * hand a full batch to the workers, blocks while the queue is full
+ *
+ ****/
+
+PRIVATE void enqueueBatch(struct batchQueue_s *queue, struct lineBatch_s *batch)
+{
+  pthread_mutex_lock(&queue->lock);
+  while (queue->depth >= queue->maxDepth)
+    pthread_cond_wait(&queue->notFull, &queue->lock);
+
+  batch->next = NULL;
+  if (queue->tail == NULL)
+    queue->head = batch;
+  else
+    queue->tail->next = batch;
+  queue->tail = batch;
+  queue->depth++;
+
+  pthread_cond_signal(&queue->notEmpty);
+  pthread_mutex_unlock(&queue->lock);
+}
+
+/****
+ *
+ * take the next batch, returns NULL once the reader is done
+ *
+ ****/
+
+PRIVATE struct lineBatch_s *dequeueBatch(struct batchQueue_s *queue)
+{
+  struct lineBatch_s *batch;
+
+  pthread_mutex_lock(&queue->lock);
+  while ((queue->head == NULL) && !queue->done)
+    pthread_cond_wait(&queue->notEmpty, &queue->lock);
+
+  if ((batch = queue->head) != NULL)
+  {
+    if ((queue->head = batch->next) == NULL)
+      queue->tail = NULL;
+    queue->depth--;
+    pthread_cond_signal(&queue->notFull);
+  }
+  pthread_mutex_unlock(&queue->lock);
+
+  return batch;
+}
+
+/****
+ *
+ * return a processed batch to the free list
+ *
+ ****/
+
+PRIVATE void releaseBatch(struct batchQueue_s *queue, struct lineBatch_s *batch)
+{
+  pthread_mutex_lock(&queue->lock);
+  batch->next = queue->freeList;
+  queue->freeList = batch;
+  pthread_mutex_unlock(&queue->lock);
+}
+
+/****
+ *
+ * record the field values of an early template occurrence
+ *
+ ****/
+
+PRIVATE void addFieldSample(struct worker_s *worker, struct workerTemplate_s *wt, int fieldCount, uint64_t seq)
+{
+  struct fieldSample_s *sample;
+  parser_field_t field;
+  int i;
+
+  if (fieldCount < 1)
+    fieldCount = 1;
+
+  sample = (struct fieldSample_s *)XMALLOC(sizeof(struct fieldSample_s) + (sizeof(char *) * (fieldCount - 1)));
+  sample->seq = seq;
+  sample->fieldCount = fieldCount - 1;
+  sample->next = NULL;
+
+  for (i = 1; i < fieldCount; i++)
+  {
+    if (getParserField(worker->parser, worker->ctx, i, &field) == TRUE)
+      sample->values[i - 1] = internStringLen(worker->intern, field.ptr, field.len);
+    else
+      sample->values[i - 1] = NULL;
+  }
+
+  if (wt->lastSample == NULL)
+    wt->samples = sample;
+  else
+    wt->lastSample->next = sample;
+  wt->lastSample = sample;
+  wt->sampleCount++;
+}
+
+/****
+ *
+ * add the field values of an occurrence to the template's sketches
+ *
+ ****/
+
+PRIVATE void addFieldSketches(struct worker_s *worker, struct workerTemplate_s *wt, int fieldCount)
+{
+  parser_field_t field;
+  int i;
+
+  if (wt->sketches == NULL)
+  {
+    if (fieldCount <= 1)
+      return;
+    wt->sketchCount = fieldCount - 1;
+    wt->sketches = (hll_t *)XMALLOC(sizeof(hll_t) * wt->sketchCount);
+    XMEMSET(wt->sketches, 0, sizeof(hll_t) * wt->sketchCount);
+  }
+
+  for (i = 1; (i < fieldCount) && (i <= wt->sketchCount); i++)
+    if (getParserField(worker->parser, worker->ctx, i, &field) == TRUE)
+      hllAdd(&wt->sketches[i - 1], hashKey(field.ptr, (int)field.len));
+}
+
+/****
+ *
+ * template one line into the worker's local hash
+ *
+ ****/
+
+PRIVATE void workerProcessLine(struct worker_s *worker, char *line, size_t len, uint64_t seq)
+{
+  const char *template;
+  parser_field_t field;
+  struct hashRec_s *tmpRec;
+  struct workerTemplate_s *wt;
+  size_t lLen;
+  int ret, templateLen;
+
+  if ((ret = worker->parser->parseLine(worker->ctx, line, (int)len)) <= 0)
+    return;
+
+  getParserField(worker->parser, worker->ctx, 0, &field);
+  template = field.ptr;
+  templateLen = field.len + 1;
+
+  /* templates loaded with -t are stored without metadata and ignored */
+  if (((tmpRec = snoopHashRecordWithHash(templateHash, template, templateLen, field.hash)) != NULL) && (tmpRec->data == NULL))
+    return;
+  if (inTemplateDb(template, (size_t)templateLen, field.hash))
+    return;
+
+  if ((tmpRec = getHashRecordWithHash(worker->hash, template, templateLen, field.hash)) == NULL)
+  { /* new template for this worker */
+    wt = (struct workerTemplate_s *)XMALLOC(sizeof(struct workerTemplate_s));
+    XMEMSET(wt, 0, sizeof(struct workerTemplate_s));
+    wt->count = 1;
+    wt->firstSeen = seq;
+    lLen = strnlen(line, (len < LINEBUF_SIZE - 1) ? len : LINEBUF_SIZE - 1);
+    wt->lBuf = (char *)XMALLOC(lLen + 1);
+    XMEMCPY(wt->lBuf, line, lLen);
+    wt->lBuf[lLen] = '\0';
+
+    if (addUniqueHashRecWithHash(worker->hash, template, templateLen, field.hash, wt) == NULL)
+    {
+      fprintf(stderr, "ERR - Unable to add hash record\n");
+      XFREE(wt->lBuf);
+      XFREE(wt);
+      return;
+    }
+
+    if (config->cluster)
+      addFieldSample(worker, wt, ret, seq);
+    if (config->estimate)
+      addFieldSketches(worker, wt, ret);
+
+    /* grow the hash if load factor exceeds 0.75 */
+    if (worker->hash->totalRecords * 4 > worker->hash->size * 3)
+      worker->hash = dyGrowHash(worker->hash);
+  }
+  else
+  {
+    wt = (struct workerTemplate_s *)tmpRec->data;
+    wt->count++;
+
+    /* only the first few occurrences feed the field tracking */
+    if (config->cluster && (wt->count <= (size_t)config->clusterDepth))
+      addFieldSample(worker, wt, ret, seq);
+    if (config->estimate)
+      addFieldSketches(worker, wt, ret);
+  }
+}
+
+/****
+ *
+ * worker thread
+ *
+ ****/
+
+PRIVATE void *workerMain(void *arg)
+{
+  struct worker_s *worker = (struct worker_s *)arg;
+  struct lineBatch_s *batch;
+  sigset_t sigSet;
+  int i;
+
+  /* leave the stats alarm to the reader thread */
+  sigemptyset(&sigSet);
+  sigaddset(&sigSet, SIGALRM);
+  pthread_sigmask(SIG_BLOCK, &sigSet, NULL);
+
+  while ((batch = dequeueBatch(worker->queue)) != NULL)
+  {
+    for (i = 0; i < batch->lineCount; i++)
+      workerProcessLine(worker, batch->line[i], batch->lineLen[i], batch->firstSeq + (uint64_t)i);
+    releaseBatch(worker->queue, batch);
+  }
+
+  worker->parser->deinit(worker->ctx);
+  worker->ctx = NULL;
+
+  return NULL;
+}
+
+/****
+ *
+ * range worker thread, templates its own slice of a mapped file
+ *
+ * the byte offset of each line stands in for the line number so the
+ * merge still picks the earliest occurrence across ranges
+ *
+ ****/
+
+PRIVATE void *rangeWorkerMain(void *arg)
+{
+  struct worker_s *worker = (struct worker_s *)arg;
+  char *line = worker->rangeStart, *end = worker->rangeStart + worker->rangeLen, *nl, *tail;
+  size_t avail, len;
+  sigset_t sigSet;
+
+  /* leave the stats alarm to the main thread */
+  sigemptyset(&sigSet);
+  sigaddset(&sigSet, SIGALRM);
+  pthread_sigmask(SIG_BLOCK, &sigSet, NULL);
+
+  while ((line < end) && !quit)
+  {
+    /* split lines exactly as readInputLine() does */
+    avail = (size_t)(end - line);
+    if ((nl = memchr(line, '\n', (avail < INPUT_MAX_LINE) ? avail : INPUT_MAX_LINE)) != NULL)
+      len = (size_t)(nl - line) + 1;
+    else if (avail > INPUT_MAX_LINE)
+      len = INPUT_MAX_LINE;
+    else
+    {
+      /* unterminated last line, copy it so the parser never touches past the mapping */
+      tail = (char *)XMALLOC(avail + 1);
+      memcpy(tail, line, avail);
+      tail[avail] = '\0';
+      workerProcessLine(worker, tail, avail, worker->rangeOff + (uint64_t)(line - worker->rangeStart));
+      XFREE(tail);
+      break;
+    }
+
+    workerProcessLine(worker, line, len, worker->rangeOff + (uint64_t)(line - worker->rangeStart));
+    line += len;
+  }
+
+  worker->parser->deinit(worker->ctx);
+  worker->ctx = NULL;
+
+  return NULL;
+}
+
+/****
+ *
+ * split a mapped file into one newline aligned byte range per worker
+ *
+ ****/
+
+PRIVATE void splitRanges(input_t *in, struct worker_s *workers, int workerCount)
+{
+  size_t start = 0, end;
+  char *nl;
+  int i;
+
+  for (i = 0; i < workerCount; i++)
+  {
+    if (i == workerCount - 1)
+      end = in->mapLen;
+    else
+    {
+      end = (size_t)(((uint64_t)in->mapLen * (uint64_t)(i + 1)) / (uint64_t)workerCount);
+      if (end < start)
+        end = start;
+      /* a range ends just past a newline so the next one starts a line */
+      if ((end > 0) && (end < in->mapLen) && (in->map[end - 1] != '\n'))
+      {
+        if ((nl = memchr(in->map + end, '\n', in->mapLen - end)) != NULL)
+          end = (size_t)(nl - in->map) + 1;
+        else
+          end = in->mapLen;
+      }
+    }
+
+    workers[i].rangeStart = in->map + start;
+    workers[i].rangeLen = end - start;
+    workers[i].rangeOff = start;
+    start = end;
+  }
+}
+
+/****
+ *
+ * chain identical templates from all workers under one merge record
+ *
+ ****/
+
+PRIVATE int collectWorkerTemplate(const struct hashRec_s *hashRec)
+{
+  struct workerTemplate_s *wt = (struct workerTemplate_s *)hashRec->data;
+  struct hashRec_s *tmpRec;
+
+  if ((tmpRec = getHashRecordWithHash(mergeHash, hashRec->keyString, hashRec->keyLen, hashRec->hashValue)) == NULL)
+  {
+    wt->nextWorker = NULL;
+    if (addUniqueHashRecWithHash(mergeHash, hashRec->keyString, hashRec->keyLen, hashRec->hashValue, wt) == NULL)
+    {
+      fprintf(stderr, "ERR - Unable to add hash record\n");
+      return TRUE;
+    }
+    if (mergeHash->totalRecords * 4 > mergeHash->size * 3)
+      mergeHash = dyGrowHash(mergeHash);
+  }
+  else
+  {
+    wt->nextWorker = (struct workerTemplate_s *)tmpRec->data;
+    tmpRec->data = wt;
+  }
+
+  return FALSE;
+}
+
+/****
+ *
+ * order field samples by input position
+ *
+ ****/
+
+PRIVATE int compareSamples(const void *a, const void *b)
+{
+  const struct fieldSample_s *sa = *(const struct fieldSample_s *const *)a;
+  const struct fieldSample_s *sb = *(const struct fieldSample_s *const *)b;
+
+  if (sa->seq < sb->seq)
+    return -1;
+  return (sa->seq > sb->seq);
+}
+
+/****
+ *
+ * feed the earliest samples into the template's field list
+ *
+ * replaying in input order reproduces exactly what the single
+ * threaded path would have tracked
+ *
+ ****/
+
+PRIVATE void replaySamples(metaData_t *md, struct workerTemplate_s *wtList, int sampleCount, size_t wanted)
+{
+  struct fieldSample_s **samples, *sample;
+  struct workerTemplate_s *wt;
+  uint32_t j;
+  int i, n = 0;
+
+  samples = (struct fieldSample_s **)XMALLOC(sizeof(struct fieldSample_s *) * sampleCount);
+  for (wt = wtList; wt != NULL; wt = wt->nextWorker)
+    for (sample = wt->samples; sample != NULL; sample = sample->next)
+      samples[n++] = sample;
+
+  qsort(samples, n, sizeof(struct fieldSample_s *), compareSamples);
+
+  for (i = 0; (i < n) && ((size_t)i < wanted) && !md->all_fields_stopped_tracking; i++)
+    for (j = 0; (j < md->fieldCount) && (j < (uint32_t)samples[i]->fieldCount); j++)
+      trackFieldValue(md, j, samples[i]->values[j]);
+
+  XFREE(samples);
+}
+
+/****
+ *
+ * fold every worker's field sketches into the template's fields
+ *
+ ****/
+
+PRIVATE void mergeSketches(metaData_t *md, struct workerTemplate_s *wtList)
+{
+  struct workerTemplate_s *wt;
+  uint32_t j;
+
+  for (wt = wtList; wt != NULL; wt = wt->nextWorker)
+    for (j = 0; (j < md->fieldCount) && (j < (uint32_t)wt->sketchCount); j++)
+      hllMerge(&md->fields[j].hll, &wt->sketches[j]);
+}
+
+/****
+ *
+ * merge one template's worker records into the global template hash
+ *
+ ****/
+
+PRIVATE int mergeTemplate(const struct hashRec_s *hashRec)
+{
+  struct workerTemplate_s *wtList = (struct workerTemplate_s *)hashRec->data;
+  struct workerTemplate_s *wt, *first = NULL;
+  struct hashRec_s *tmpRec;
+  metaData_t *tmpMd;
+  size_t count = 0, tracked, depth;
+  uint32_t fields;
+  int sampleCount = 0;
+
+  for (wt = wtList; wt != NULL; wt = wt->nextWorker)
+  {
+    count += wt->count;
+    sampleCount += wt->sampleCount;
+    if ((first == NULL) || (wt->firstSeen < first->firstSeen))
+      first = wt;
+  }
+
+  if ((tmpRec = getHashRecordWithHash(templateHash, hashRec->keyString, hashRec->keyLen, hashRec->hashValue)) == NULL)
+  { /* new template */
+    /* every worker sampled the first occurrence of its templates */
+    fields = (config->cluster && (first->samples != NULL)) ? (uint32_t)first->samples->fieldCount : 0;
+    if ((tmpMd = newMetaData(first->lBuf, strlen(first->lBuf), fields)) == NULL)
+    {
+      fprintf(stderr, "ERR - Unable to allocate template record\n");
+      return FALSE;
+    }
+    /* after everything stored before this file */
+    tmpMd->firstSeen = inputSeq + 1 + first->firstSeen;
+
+    if (addUniqueHashRecWithHash(templateHash, hashRec->keyString, hashRec->keyLen, hashRec->hashValue, tmpMd) == NULL)
+    {
+      fprintf(stderr, "ERR - Unable to add hash record\n");
+      return FALSE;
+    }
+
+    /* grow the hash if load factor exceeds 0.75 for better performance */
+    if (templateHash->totalRecords * 4 > templateHash->size * 3)
+      templateHash = dyGrowHash(templateHash);
+  }
+  else
+    tmpMd = (metaData_t *)tmpRec->data;
+
+  /* occurrences already tracked by earlier files */
+  depth = (size_t)config->clusterDepth;
+  tracked = (tmpMd->count < depth) ? tmpMd->count : depth;
+  tmpMd->count += count;
+
+  if (config->cluster && (sampleCount > 0) && (tracked < depth))
+    replaySamples(tmpMd, wtList, sampleCount, depth - tracked);
+  if (config->estimate)
+    mergeSketches(tmpMd, wtList);
+
+  return FALSE;
+}
+
+/****
+ *
+ * free a worker template record
+ *
+ ****/
+
+PRIVATE int freeWorkerTemplate(const struct hashRec_s *hashRec)
+{
+  struct workerTemplate_s *wt = (struct workerTemplate_s *)hashRec->data;
+  struct fieldSample_s *sample, *nextSample;
+  int i;
+
+  if (wt == NULL)
+    return FALSE;
+
+  for (sample = wt->samples; sample != NULL; sample = nextSample)
+  {
+    nextSample = sample->next;
+    XFREE(sample);
+  }
+  if (wt->sketches != NULL)
+  {
+    for (i = 0; i < wt->sketchCount; i++)
+      hllFree(&wt->sketches[i]);
+    XFREE(wt->sketches);
+  }
+  XFREE(wt->lBuf);
+  XFREE(wt);
+
+  return FALSE;
+}
+
+/****
+ *
+ * process an open file with config->threads parser workers
+ *
+ * a mapped file is split into byte ranges that the workers parse
+ * concurrently. other input is read and batched by the calling thread.
+ * either way each worker builds its own template hash and the results
+ * are merged into templateHash
+ *
+ ****/
+
+int pipelineProcessFile(input_t *in, ParserInterface *parser)
+{
+  struct batchQueue_s queue;
+  struct worker_s *workers;
+  struct lineBatch_s *batch = NULL;
+  char *line;
+  size_t lLen;
+  sigset_t sigSet;
+  int mapped = inputIsMapped(in);
+  void *(*threadMain)(void *) = mapped ? rangeWorkerMain : workerMain;
+  uint64_t seq = 0;
+  unsigned int lineCount = 0;
+  int i, started = 0, ret = TRUE;
+  int workerCount = config->threads;
+
+  XMEMSET(&queue, 0, sizeof(queue));
+  pthread_mutex_init(&queue.lock, NULL);
+  pthread_cond_init(&queue.notEmpty, NULL);
+  pthread_cond_init(&queue.notFull, NULL);
+  queue.maxDepth = workerCount * PIPELINE_QUEUE_DEPTH;
+
+  if (config->debug >= 2)
+    fprintf(stderr, "DEBUG - Using %d parser threads\n", workerCount);
+
+  workers = (struct worker_s *)XMALLOC(sizeof(struct worker_s) * workerCount);
+  XMEMSET(workers, 0, sizeof(struct worker_s) * workerCount);
+  if (mapped)
+    splitRanges(in, workers, workerCount);
+  for (i = 0; i < workerCount; i++)
+  {
+    workers[i].queue = &queue;
+    workers[i].parser = parser;
+    workers[i].hash = initSwissHash(config->cluster ? 12289 : 389);
+    workers[i].intern = initStringIntern();
+    if ((workers[i].ctx = parser->init()) == NULL)
+      break;
+    if (pthread_create(&workers[i].thread, NULL, threadMain, &workers[i]) != 0)
+    {
+      fprintf(stderr, "ERR - Unable to start parser thread %d (%s)\n", i, strerror(errno));
+      break;
+    }
+    workers[i].started = TRUE;
+    started++;
+  }
+
+  if (mapped)
+  { /* every range has to be parsed, do the ones without a thread here */
+    pthread_sigmask(SIG_BLOCK, NULL, &sigSet);
+    for (i = 0; (i < workerCount) && (ret == TRUE); i++)
+    {
+      if (workers[i].started)
+        continue;
+      if (workers[i].hash == NULL)
+      {
+        workers[i].hash = initSwissHash(config->cluster ? 12289 : 389);
+        workers[i].intern = initStringIntern();
+      }
+      if ((workers[i].ctx == NULL) && ((workers[i].ctx = parser->init()) == NULL))
+        ret = FAILED;
+      else
+        rangeWorkerMain(&workers[i]);
+    }
+    pthread_sigmask(SIG_SETMASK, &sigSet, NULL);
+  }
+  else if (started == 0)
+    ret = FAILED;
+
+  while ((ret == TRUE) && !mapped && !quit && readInputLine(in, &line, &lLen))
+  {
+    if (reload == TRUE)
+    {
+      fprintf(stderr, "Processed %d lines/min\n", lineCount);
+      lineCount = 0;
+      reload = FALSE;
+    }
+
+    if ((batch != NULL) && ((batch->lineCount == PIPELINE_BATCH_LINES) || (batch->used + lLen > PIPELINE_BATCH_SIZE)))
+    {
+      enqueueBatch(&queue, batch);
+      batch = NULL;
+    }
+    if (batch == NULL)
+    {
+      batch = getFreeBatch(&queue);
+      batch->firstSeq = seq;
+    }
+
+    /* the stream buffer is reused by the next read */
+    XMEMCPY(batch->buf + batch->used, line, lLen);
+    batch->line[batch->lineCount] = batch->buf + batch->used;
+    batch->used += lLen;
+    batch->lineLen[batch->lineCount++] = lLen;
+    seq++;
+    lineCount++;
+  }
+
+  if (batch != NULL)
+  {
+    if (batch->lineCount > 0)
+      enqueueBatch(&queue, batch);
+    else
+      releaseBatch(&queue, batch);
+  }
+
+  /* let the workers drain the queue and exit */
+  pthread_mutex_lock(&queue.lock);
+  queue.done = TRUE;
+  pthread_cond_broadcast(&queue.notEmpty);
+  pthread_mutex_unlock(&queue.lock);
+
+  for (i = 0; i < workerCount; i++)
+    if (workers[i].started)
+      pthread_join(workers[i].thread, NULL);
+
+  /* merge worker results into the global template hash */
+  if (ret == TRUE)
+  {
+    mergeHash = initSwissHash(config->cluster ? 12289 : 389);
+    for (i = 0; i < workerCount; i++)
+      if (workers[i].hash != NULL)
+        traverseHash(workers[i].hash, collectWorkerTemplate);
+    traverseHash(mergeHash, mergeTemplate);
+    freeHash(mergeHash);
+    mergeHash = NULL;
+  }
+  /* worker positions are line numbers or, for a mapped file, byte offsets */
+  inputSeq += (mapped ? (uint64_t)in->mapLen : seq) + 1;
+
+  /* cleanup */
+  for (i = 0; i < workerCount; i++)
+  {
+    if (workers[i].ctx != NULL)
+      parser->deinit(workers[i].ctx);
+    if (workers[i].hash == NULL)
+      continue;
+    traverseHash(workers[i].hash, freeWorkerTemplate);
+    freeHash(workers[i].hash);
+    freeStringIntern(workers[i].intern);
+  }
+  XFREE(workers);
+
+  while ((batch = queue.freeList) != NULL)
+  {
+    queue.freeList = batch->next;
+    XFREE(batch->buf);
+    XFREE(batch);
+  }
+  pthread_cond_destroy(&queue.notFull);
+  pthread_cond_destroy(&queue.notEmpty);
+  pthread_mutex_destroy(&queue.lock);
+
+  return ret;
+}
+
+#endif /* HAVE_PTHREAD_H */
@@ -0,0 +1,107 @@
+/*****
+ *
+ * Description: Multi-threaded Map/Merge Pipeline Headers
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#ifndef PIPELINE_DOT_H
+#define PIPELINE_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+#include "tmpltr.h"
+#include "parser_interface.h"
+#include "input.h"
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+#define PIPELINE_MAX_THREADS 256
+#define PIPELINE_BATCH_LINES 1024
+#define PIPELINE_BATCH_SIZE (256 * 1024)   /* must hold at least one INPUT_MAX_LINE line */
+#define PIPELINE_QUEUE_DEPTH 4             /* batches queued per worker */
+
+/****
+ *
+ * typedefs & structs
+ *
+ ****/
+
+/* a block of input lines handed from the reader to a worker */
+struct lineBatch_s
+{
+  char *buf;                               /* copied lines when the input is not mapped */
+  size_t used;
+  char *line[PIPELINE_BATCH_LINES];        /* start of each line, in buf or the mapping */
+  size_t lineLen[PIPELINE_BATCH_LINES];
+  int lineCount;
+  uint64_t firstSeq;                       /* input line number of the first line */
+  struct lineBatch_s *next;
+};
+
+/* field values of one early occurrence of a template */
+struct fieldSample_s
+{
+  uint64_t seq;                            /* input line number */
+  int fieldCount;
+  struct fieldSample_s *next;
+  const char *values[];                    /* interned in the worker's interner */
+};
+
+/* worker-local template record, merged into templateHash at the end */
+struct workerTemplate_s
+{
+  size_t count;
+  uint64_t firstSeen;                      /* input line number of first occurrence */
+  char *lBuf;                              /* first line this worker saw */
+  int sampleCount;
+  struct fieldSample_s *samples;           /* first clusterDepth occurrences, in order */
+  struct fieldSample_s *lastSample;
+  hll_t *sketches;                         /* per field, every occurrence, with -e */
+  int sketchCount;
+  struct workerTemplate_s *nextWorker;     /* same template in other workers (merge only) */
+};
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+int pipelineProcessFile(input_t *in, ParserInterface *parser);
+
+#endif /* PIPELINE_DOT_H */
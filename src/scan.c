@@ -0,0 +1,265 @@
+/*****
+ *
+ * Description: Character Class Run Scanner
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+/****
+ *
+ * the parser spends most of its states walking runs of bytes that do
+ * not change its state, the kernels here find the end of such a run
+ * 16, 32 or 64 bytes at a time
+ *
+ * a byte's class membership is looked up with two pshufb's, the low
+ * nibble picks a row of the class bitmap and the high nibble picks the
+ * bit, bytes 0x80 and up are in no class
+ *
+ * the kernel is picked once from what the running cpu supports, see
+ * cpu.c
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "scan.h"
+#include "cpu.h"
+#include "mem.h"
+
+/****
+ *
+ * external global variables
+ *
+ ****/
+
+extern Config_t *config;
+
+/****
+ *
+ * global variables
+ *
+ ****/
+
+/* bit (1 << class) is set for each run class the byte belongs to */
+PUBLIC uint8_t runClassTable[256];
+PUBLIC runScanner_t runScanner = NULL;
+
+/****
+ *
+ * local variables
+ *
+ ****/
+
+/* per class, low nibble -> bitmap of the high nibbles 0-7 in the class */
+PRIVATE uint8_t runNibbleTable[RUN_CLASS_COUNT][16];
+PRIVATE int scanKernel = SCAN_KERNEL_SCALAR;
+PRIVATE const char *scanKernelNames[] = {"scalar", "sse4.2", "avx2", "avx512bw"};
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * one byte at a time, for cpus without the vector kernels and for tails
+ *
+ ****/
+
+PRIVATE size_t scanScalar(const char *str, size_t len, int runClass)
+{
+  uint8_t bit = (uint8_t)(1 << runClass);
+  size_t i;
+
+  for (i = 0; (i < len) && (runClassTable[(unsigned char)str[i]] & bit); i++)
+    ;
+  return i;
+}
+
+#ifdef CPU_X86
+
+/****
+ *
+ * 16 bytes at a time
+ *
+ ****/
+
+CPU_TARGET("sse4.2")
+PRIVATE size_t scanSse42(const char *str, size_t len, int runClass)
+{
+  const __m128i lut = _mm_loadu_si128((const __m128i *)runNibbleTable[runClass]);
+  const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+  const __m128i zero = _mm_setzero_si128();
+  __m128i v, rows, cols;
+  uint32_t miss;
+  size_t i;
+
+  for (i = 0; i + 16 <= len; i += 16)
+  {
+    v = _mm_loadu_si128((const __m128i *)(str + i));
+    rows = _mm_shuffle_epi8(lut, _mm_and_si128(v, nibble));
+    cols = _mm_shuffle_epi8(bits, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+    if ((miss = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(rows, cols), zero))) != 0)
+      return i + (size_t)__builtin_ctz(miss);
+  }
+  return i + scanScalar(str + i, len - i, runClass);
+}
+
+/****
+ *
+ * 32 bytes at a time, pshufb works per 128 bit lane so the tables are
+ * in both lanes
+ *
+ ****/
+
+CPU_TARGET("avx2")
+PRIVATE size_t scanAvx2(const char *str, size_t len, int runClass)
+{
+  const __m256i lut = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)runNibbleTable[runClass]));
+  const __m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0,
+                                        1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i v, rows, cols;
+  uint32_t miss;
+  size_t i;
+
+  for (i = 0; i + 32 <= len; i += 32)
+  {
+    v = _mm256_loadu_si256((const __m256i *)(str + i));
+    rows = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, nibble));
+    cols = _mm256_shuffle_epi8(bits, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+    if ((miss = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(rows, cols), zero))) != 0)
+      return i + (size_t)__builtin_ctz(miss);
+  }
+  return i + scanSse42(str + i, len - i, runClass);
+}
+
+/****
+ *
+ * 64 bytes at a time, the compare goes straight to a mask register
+ *
+ ****/
+
+CPU_TARGET("avx512bw")
+PRIVATE size_t scanAvx512(const char *str, size_t len, int runClass)
+{
+  const __m512i lut = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)runNibbleTable[runClass]));
+  const __m512i bits = _mm512_broadcast_i32x4(_mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0));
+  const __m512i nibble = _mm512_set1_epi8(0x0f);
+  __m512i v, rows, cols;
+  uint64_t miss;
+  size_t i;
+
+  for (i = 0; i + 64 <= len; i += 64)
+  {
+    v = _mm512_loadu_si512((const void *)(str + i));
+    rows = _mm512_shuffle_epi8(lut, _mm512_and_si512(v, nibble));
+    cols = _mm512_shuffle_epi8(bits, _mm512_and_si512(_mm512_srli_epi16(v, 4), nibble));
+    if ((miss = (uint64_t)_mm512_testn_epi8_mask(rows, cols)) != 0)
+      return i + (size_t)__builtin_ctzll(miss);
+  }
+  return i + scanAvx2(str + i, len - i, runClass);
+}
+
+#endif /* CPU_X86 */
+
+/****
+ *
+ * build the class tables and pick the kernel
+ *
+ * DESCRIPTION:
+ *   The classes mirror the parser, a STRING run goes on over alnum and
+ *   the punctuation that can sit inside a token, between quotes it also
+ *   goes on over the separators.  A NUM_INT run is digits only.
+ *
+ * PRECONDITIONS:
+ *   Called before any parser thread is started, initParser() does this
+ *
+ * POSTCONDITIONS:
+ *   runScanner is set, later calls do nothing
+ *
+ ****/
+
+void initScanners(void)
+{
+  const char *stringChars = ".-#$~^@%_\\*";
+  const char *quotedChars = "><,:;+!/ \t=?{}][\'`&()\r";
+  const char *p;
+  int c, runClass;
+
+  if (runScanner != NULL)
+    return;
+
+  for (c = 0; c < 256; c++)
+  {
+    if (FAST_ISALNUM(c))
+      runClassTable[c] |= (1 << RUN_CLASS_STRING) | (1 << RUN_CLASS_QUOTED);
+    if (FAST_ISDIGIT(c))
+      runClassTable[c] |= (1 << RUN_CLASS_DIGIT);
+  }
+  for (p = stringChars; *p != '\0'; p++)
+    runClassTable[(unsigned char)*p] |= (1 << RUN_CLASS_STRING) | (1 << RUN_CLASS_QUOTED);
+  for (p = quotedChars; *p != '\0'; p++)
+    runClassTable[(unsigned char)*p] |= (1 << RUN_CLASS_QUOTED);
+
+  for (runClass = 0; runClass < RUN_CLASS_COUNT; runClass++)
+    for (c = 0; c < 128; c++)
+      if (runClassTable[c] & (1 << runClass))
+        runNibbleTable[runClass][c & 0x0f] |= (uint8_t)(1 << (c >> 4));
+
+  runScanner = scanScalar;
+  scanKernel = SCAN_KERNEL_SCALAR;
+#ifdef CPU_X86
+  if (cpuHas(CPU_AVX512BW))
+  {
+    runScanner = scanAvx512;
+    scanKernel = SCAN_KERNEL_AVX512;
+  }
+  else if (cpuHas(CPU_AVX2))
+  {
+    runScanner = scanAvx2;
+    scanKernel = SCAN_KERNEL_AVX2;
+  }
+  else if (cpuHas(CPU_SSE42))
+  {
+    runScanner = scanSse42;
+    scanKernel = SCAN_KERNEL_SSE42;
+  }
+#endif
+
+  if (config->debug >= 2)
+    fprintf(stderr, "DEBUG - Using %s run scanner\n", scanKernelName());
+}
+
+/****
+ *
+ * name of the kernel initScanners() picked
+ *
+ ****/
+
+const char *scanKernelName(void)
+{
+  return scanKernelNames[scanKernel];
+}
@@ -0,0 +1,111 @@
+/*****
+ *
+ * Description: Character Class Run Scanner Headers
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#ifndef SCAN_DOT_H
+#define SCAN_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+/* run classes, the bytes a parser state consumes without changing state */
+#define RUN_CLASS_STRING 0                 /* alnum and . - # $ ~ ^ @ % _ \ * */
+#define RUN_CLASS_QUOTED 1                 /* string plus the printables allowed between quotes */
+#define RUN_CLASS_DIGIT 2                  /* 0-9 */
+#define RUN_CLASS_COUNT 3
+
+#define SCAN_INLINE_BYTES 8                /* run bytes tested before calling a kernel */
+
+/* scanner kernels, best last */
+#define SCAN_KERNEL_SCALAR 0
+#define SCAN_KERNEL_SSE42 1
+#define SCAN_KERNEL_AVX2 2
+#define SCAN_KERNEL_AVX512 3
+
+/****
+ *
+ * typedefs & structs
+ *
+ ****/
+
+typedef size_t (*runScanner_t)(const char *str, size_t len, int runClass);
+
+/****
+ *
+ * external variables
+ *
+ ****/
+
+extern uint8_t runClassTable[256];
+extern runScanner_t runScanner;
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+void initScanners(void);
+const char *scanKernelName(void);
+
+/****
+ *
+ * length of the run of runClass bytes at the start of str, at most len
+ *
+ * most runs in log lines are a few bytes long and end before a vector
+ * load pays for itself, the first SCAN_INLINE_BYTES are tested here and
+ * only longer runs go to the kernel
+ *
+ ****/
+
+static inline size_t scanRun(const char *str, size_t len, int runClass)
+{
+  uint8_t bit = (uint8_t)(1 << runClass);
+  size_t i;
+
+  for (i = 0; i < SCAN_INLINE_BYTES; i++)
+    if ((i == len) || !(runClassTable[(unsigned char)str[i]] & bit))
+      return i;
+  return i + runScanner(str + i, len - i, runClass);
+}
+
+#endif /* SCAN_DOT_H */
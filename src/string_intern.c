@@ -197,7 +197,7 @@ static void *allocFromPool(string_intern_t *intern, size_t size)
  *
  * DESCRIPTION:
  *   Interns a string with known length for optimal performance.
- *   Uses FNV-1a hash for fast comparison and efficient distribution.
+ *   Uses hashKey() for fast comparison and efficient distribution.
  *
  * PARAMETERS:
  *   intern - String interning system
@@ -222,8 +222,8 @@ const char *internStringLen(string_intern_t *intern, const char *str, size_t len
 
     if (!intern || !str) return NULL;
 
-    /* Compute FNV-1a hash */
-    hash = fnv1aHash(str, len);
+    /* keep the low half of the 64 bit key hash */
+    hash = (uint32_t)hashKey(str, (int)len);
     bucket = hash % intern->hash_size;
 
     /* Search for existing string */
@@ -30,6 +30,7 @@
  ****/
 
 #include <stdint.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -99,6 +100,11 @@ void getInternStats(string_intern_t *intern, uint32_t *num_strings, size_t *memo
 /* Resize string intern hash table when load factor gets too high */
 int resizeInternHashTable(string_intern_t *intern);
 
+/* Hash of an interned string, computed once when it was interned */
+static inline uint32_t internedStringHash(const char *str) {
+    return ((const interned_string_t *)(const void *)(str - offsetof(interned_string_t, data)))->hash;
+}
+
 /* Fast string equality check for interned strings */
 static inline int internedStringEqual(const char *a, const char *b) {
     return (a == b);  /* Pointer equality is sufficient for interned strings */
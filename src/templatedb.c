@@ -0,0 +1,413 @@
+/*****
+ *
+ * Description: Binary Template Database
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+/****
+ *
+ * a template file loaded with -t is read line by line and every
+ * template is hashed and copied into the template hash before the
+ * first log line is looked at.  a template database is the same set
+ * already hashed and indexed, it is mapped read only and queried in
+ * place, so there is no load phase and concurrent runs share the
+ * pages
+ *
+ ****/
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#include "templatedb.h"
+
+/****
+ *
+ * external variables
+ *
+ ****/
+
+extern Config_t *config;
+
+/****
+ *
+ * global variables
+ *
+ ****/
+
+/* databases loaded with -t, newest first */
+PUBLIC struct templateDb_s *templateDbs = NULL;
+
+/****
+ *
+ * local variables
+ *
+ ****/
+
+/* keys gathered by writeTemplateDb(), traverseHash() callbacks take no context */
+struct dbKey_s
+{
+  uint64_t hash;
+  const char *key;
+  uint32_t keyLen;                         /* 0 once found to be a duplicate */
+  uint64_t slot;
+};
+
+PRIVATE struct dbKey_s *dbKeys = NULL;
+PRIVATE size_t dbKeyCount = 0;
+PRIVATE size_t dbKeySize = 0;
+
+/****
+ *
+ * functions
+ *
+ ****/
+
+/****
+ *
+ * sanity check a header against the file it came from
+ *
+ ****/
+
+PRIVATE int validTemplateDbHeader(const struct templateDbHeader_s *hdr, uint64_t fileLen)
+{
+  if ((hdr->version != TEMPLATE_DB_VERSION) || (hdr->byteOrder != TEMPLATE_DB_BYTE_ORDER))
+    return FALSE;
+  if (hdr->hashCheck != hashKey(TEMPLATE_DB_MAGIC, TEMPLATE_DB_MAGIC_LEN))
+    return FALSE;
+  if ((hdr->slotCount < TEMPLATE_DB_MIN_SLOTS) || (hdr->slotCount & (hdr->slotCount - 1)) || (hdr->count >= hdr->slotCount))
+    return FALSE;
+  if ((hdr->slotOff < sizeof(struct templateDbHeader_s)) || (hdr->slotOff % sizeof(uint64_t)) || (hdr->slotOff > fileLen))
+    return FALSE;
+  if (hdr->slotCount > (fileLen - hdr->slotOff) / sizeof(struct templateDbSlot_s))
+    return FALSE;
+  if ((hdr->blobOff > fileLen) || (hdr->blobLen > fileLen - hdr->blobOff))
+    return FALSE;
+  return TRUE;
+}
+
+/****
+ *
+ * load a template database
+ *
+ * DESCRIPTION:
+ *   Maps the file read only and adds it to the databases checked by
+ *   inTemplateDb().  Without mmap() the file is read into memory.
+ *
+ * RETURNS:
+ *   TRUE when loaded, FALSE when the file is not a template database
+ *   (it is then read as a text template file) and FAILED when it is a
+ *   damaged or incompatible one
+ *
+ ****/
+
+int loadTemplateDb(const char *fName)
+{
+  struct templateDbHeader_s hdr;
+  struct templateDb_s *db;
+  struct stat st;
+  ssize_t rCount;
+  size_t got;
+  int fd;
+
+  /* not ours to report, the text loader will */
+  if ((fd = open(fName, O_RDONLY | O_NOFOLLOW)) == -1)
+    return FALSE;
+
+  if ((fstat(fd, &st) != 0) || !S_ISREG(st.st_mode) || ((size_t)st.st_size < sizeof(hdr)) ||
+      (read(fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr)) || (memcmp(hdr.magic, TEMPLATE_DB_MAGIC, TEMPLATE_DB_MAGIC_LEN) != 0))
+  {
+    close(fd);
+    return FALSE;
+  }
+
+  if (!validTemplateDbHeader(&hdr, (uint64_t)st.st_size))
+  {
+    fprintf(stderr, "ERR - Template database [%s] is damaged or from an incompatible version\n", fName);
+    close(fd);
+    return FAILED;
+  }
+
+  db = (struct templateDb_s *)XMALLOC(sizeof(struct templateDb_s));
+  XMEMSET(db, 0, sizeof(struct templateDb_s));
+  db->mapLen = (size_t)st.st_size;
+  db->dev = st.st_dev;
+  db->ino = st.st_ino;
+
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+  if ((db->map = mmap(NULL, db->mapLen, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)
+    db->map = NULL;
+  else
+    db->mapped = TRUE;
+#endif
+
+  if (db->map == NULL)
+  {
+    db->map = (char *)XMALLOC(db->mapLen);
+    for (got = 0; got < db->mapLen; got += (size_t)rCount)
+    {
+      if ((rCount = pread(fd, db->map + got, db->mapLen - got, (off_t)got)) <= 0)
+      {
+        if ((rCount == -1) && (errno == EINTR))
+        {
+          rCount = 0;
+          continue;
+        }
+        fprintf(stderr, "ERR - Unable to read template database [%s]\n", fName);
+        XFREE(db->map);
+        XFREE(db);
+        close(fd);
+        return FAILED;
+      }
+    }
+  }
+  close(fd);
+
+  db->slots = (const struct templateDbSlot_s *)(const void *)(db->map + hdr.slotOff);
+  db->slotMask = hdr.slotCount - 1;
+  db->blob = db->map + hdr.blobOff;
+  db->blobLen = hdr.blobLen;
+  db->next = templateDbs;
+  templateDbs = db;
+
+#ifdef DEBUG
+  if (config->debug >= 1)
+    printf("DEBUG - Mapped [%lu] templates from template database\n", (unsigned long)hdr.count);
+#endif
+
+  return TRUE;
+}
+
+/****
+ *
+ * TRUE when fName is a database loaded with -t
+ *
+ ****/
+
+int templateDbLoaded(const char *fName)
+{
+  const struct templateDb_s *db;
+  struct stat st;
+
+  if (stat(fName, &st) != 0)
+    return FALSE;
+  for (db = templateDbs; db != NULL; db = db->next)
+    if ((db->dev == st.st_dev) && (db->ino == st.st_ino))
+      return TRUE;
+  return FALSE;
+}
+
+/****
+ *
+ * look a template up in every loaded database, see inTemplateDb()
+ *
+ ****/
+
+int templateDbLookup(const char *template, size_t templateLen, uint64_t hash)
+{
+  const struct templateDb_s *db;
+  const struct templateDbSlot_s *slot;
+  uint64_t i, probes;
+
+  for (db = templateDbs; db != NULL; db = db->next)
+  {
+    for (i = hash & db->slotMask, probes = 0; probes <= db->slotMask; i = (i + 1) & db->slotMask, probes++)
+    {
+      slot = &db->slots[i];
+      if (slot->keyLen == 0)
+        break;
+      if ((slot->hash == hash) && (slot->keyLen == templateLen) &&
+          ((uint64_t)slot->keyOff + slot->keyLen <= db->blobLen) &&
+          (memcmp(db->blob + slot->keyOff, template, templateLen) == 0))
+        return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/****
+ *
+ * queue a key for writeTemplateDb()
+ *
+ ****/
+
+PRIVATE void addDbKey(uint64_t hash, const char *key, uint32_t keyLen)
+{
+  if (dbKeyCount == dbKeySize)
+  {
+    dbKeySize = (dbKeySize == 0) ? 1024 : dbKeySize * 2;
+    dbKeys = (struct dbKey_s *)XREALLOC(dbKeys, sizeof(struct dbKey_s) * dbKeySize);
+  }
+  dbKeys[dbKeyCount].hash = hash;
+  dbKeys[dbKeyCount].key = key;
+  dbKeys[dbKeyCount].keyLen = keyLen;
+  dbKeys[dbKeyCount].slot = 0;
+  dbKeyCount++;
+}
+
+/****
+ *
+ * traverseHash() callback, every template in the hash
+ *
+ ****/
+
+PRIVATE int collectDbKey(const struct hashRec_s *hashRec)
+{
+  addDbKey(hashRec->hashValue, hashRec->keyString, (uint32_t)hashRec->keyLen);
+  return FALSE;
+}
+
+/****
+ *
+ * write a template database
+ *
+ * DESCRIPTION:
+ *   Writes every template in hash, seen in the logs or loaded from a
+ *   text template file, and every template of the loaded databases,
+ *   so '-t old -b -w new' merges and converts template sets.
+ *
+ * RETURNS:
+ *   TRUE or FAILED
+ *
+ ****/
+
+int writeTemplateDb(FILE *outFile, struct hash_s *hash)
+{
+  struct templateDbHeader_s hdr;
+  struct templateDbSlot_s *slots;
+  const struct templateDb_s *db;
+  const struct templateDbSlot_s *dbSlot;
+  uint64_t slotCount, mask, i, blobLen = 0, count = 0;
+  size_t k;
+  int ret = TRUE;
+
+  dbKeyCount = 0;
+  if (hash != NULL)
+    traverseHash(hash, collectDbKey);
+  for (db = templateDbs; db != NULL; db = db->next)
+    for (i = 0; i <= db->slotMask; i++)
+    {
+      dbSlot = &db->slots[i];
+      if ((dbSlot->keyLen != 0) && ((uint64_t)dbSlot->keyOff + dbSlot->keyLen <= db->blobLen))
+        addDbKey(dbSlot->hash, db->blob + dbSlot->keyOff, dbSlot->keyLen);
+    }
+
+  /* at most half full keeps probe runs short */
+  for (slotCount = TEMPLATE_DB_MIN_SLOTS; slotCount < (uint64_t)dbKeyCount * 2; slotCount <<= 1)
+    ;
+  mask = slotCount - 1;
+  slots = (struct templateDbSlot_s *)XMALLOC(sizeof(struct templateDbSlot_s) * slotCount);
+  XMEMSET(slots, 0, sizeof(struct templateDbSlot_s) * slotCount);
+
+  /* index the keys, keyOff holds the key number until the blob is laid out */
+  for (k = 0; k < dbKeyCount; k++)
+  {
+    for (i = dbKeys[k].hash & mask; slots[i].keyLen != 0; i = (i + 1) & mask)
+      if ((slots[i].hash == dbKeys[k].hash) && (slots[i].keyLen == dbKeys[k].keyLen) &&
+          (memcmp(dbKeys[slots[i].keyOff].key, dbKeys[k].key, dbKeys[k].keyLen) == 0))
+        break;
+    if (slots[i].keyLen != 0)
+    {
+      dbKeys[k].keyLen = 0;
+      continue;
+    }
+    slots[i].hash = dbKeys[k].hash;
+    slots[i].keyOff = (uint32_t)k;
+    slots[i].keyLen = dbKeys[k].keyLen;
+    dbKeys[k].slot = i;
+  }
+
+  for (k = 0; k < dbKeyCount; k++)
+  {
+    if (dbKeys[k].keyLen == 0)
+      continue;
+    slots[dbKeys[k].slot].keyOff = (uint32_t)blobLen;
+    blobLen += dbKeys[k].keyLen;
+    count++;
+  }
+
+  if (blobLen > TEMPLATE_DB_MAX_BLOB)
+  {
+    fprintf(stderr, "ERR - Templates do not fit in a template database\n");
+    ret = FAILED;
+  }
+  else
+  {
+    XMEMSET(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, TEMPLATE_DB_MAGIC, TEMPLATE_DB_MAGIC_LEN);
+    hdr.version = TEMPLATE_DB_VERSION;
+    hdr.byteOrder = TEMPLATE_DB_BYTE_ORDER;
+    hdr.hashCheck = hashKey(TEMPLATE_DB_MAGIC, TEMPLATE_DB_MAGIC_LEN);
+    hdr.count = count;
+    hdr.slotCount = slotCount;
+    hdr.slotOff = sizeof(hdr);
+    hdr.blobOff = hdr.slotOff + (sizeof(struct templateDbSlot_s) * slotCount);
+    hdr.blobLen = blobLen;
+
+    if ((fwrite(&hdr, sizeof(hdr), 1, outFile) != 1) ||
+        (fwrite(slots, sizeof(struct templateDbSlot_s), slotCount, outFile) != slotCount))
+      ret = FAILED;
+    for (k = 0; (k < dbKeyCount) && (ret == TRUE); k++)
+      if ((dbKeys[k].keyLen != 0) && (fwrite(dbKeys[k].key, 1, dbKeys[k].keyLen, outFile) != dbKeys[k].keyLen))
+        ret = FAILED;
+    if ((ret == TRUE) && (fflush(outFile) != 0))
+      ret = FAILED;
+    if (ret != TRUE)
+      fprintf(stderr, "ERR - Unable to write template database %d (%s)\n", errno, strerror(errno));
+  }
+
+#ifdef DEBUG
+  if ((ret == TRUE) && (config->debug >= 1))
+    printf("DEBUG - Wrote [%lu] templates to template database\n", (unsigned long)count);
+#endif
+
+  XFREE(slots);
+  if (dbKeys != NULL)
+    XFREE(dbKeys);
+  dbKeys = NULL;
+  dbKeyCount = dbKeySize = 0;
+
+  return ret;
+}
+
+/****
+ *
+ * unmap every loaded database
+ *
+ ****/
+
+void closeTemplateDbs(void)
+{
+  struct templateDb_s *db;
+
+  while ((db = templateDbs) != NULL)
+  {
+    templateDbs = db->next;
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+    if (db->mapped)
+      munmap(db->map, db->mapLen);
+    else
+#endif
+      XFREE(db->map);
+    XFREE(db);
+  }
+}
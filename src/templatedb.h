@@ -0,0 +1,138 @@
+/*****
+ *
+ * Description: Binary Template Database Headers
+ *
+ * Copyright (c) 2008-2025, Ron Dilley
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#ifndef TEMPLATEDB_DOT_H
+#define TEMPLATEDB_DOT_H
+
+/****
+ *
+ * includes
+ *
+ ****/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "../include/sysdep.h"
+
+#ifndef __SYSDEP_H__
+#error something is messed up
+#endif
+
+#include "../include/common.h"
+#include "mem.h"
+#include "hash.h"
+
+/****
+ *
+ * defines
+ *
+ ****/
+
+#define TEMPLATE_DB_MAGIC "TMPLTRDB"
+#define TEMPLATE_DB_MAGIC_LEN 8
+#define TEMPLATE_DB_VERSION 1
+#define TEMPLATE_DB_BYTE_ORDER 0x01020304  /* reads back swapped on the other endianness */
+#define TEMPLATE_DB_MIN_SLOTS 16
+#define TEMPLATE_DB_MAX_BLOB 0xffffffffULL /* key offsets are 32 bits */
+
+/****
+ *
+ * typedefs & structs
+ *
+ ****/
+
+/*
+ * file layout, header then slot index then key blob.  the index is
+ * open addressed with linear probing and kept at most half full, an
+ * empty slot has keyLen 0.  keys are stored with their nul and keyLen
+ * counts it, the way the template hash stores them
+ */
+struct templateDbHeader_s
+{
+  char magic[TEMPLATE_DB_MAGIC_LEN];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint64_t hashCheck;                      /* hashKey() of the magic, catches a changed hash */
+  uint64_t count;                          /* templates */
+  uint64_t slotCount;                      /* power of two */
+  uint64_t slotOff;
+  uint64_t blobOff;
+  uint64_t blobLen;
+};
+
+struct templateDbSlot_s
+{
+  uint64_t hash;                           /* hashKey() of the key and its nul */
+  uint32_t keyOff;                         /* into the blob */
+  uint32_t keyLen;
+};
+
+/* one database loaded with -t */
+struct templateDb_s
+{
+  char *map;
+  size_t mapLen;
+  int mapped;                              /* map came from mmap(), not XMALLOC() */
+  const struct templateDbSlot_s *slots;
+  uint64_t slotMask;
+  const char *blob;
+  uint64_t blobLen;
+  dev_t dev;                               /* file identity, see templateDbLoaded() */
+  ino_t ino;
+  struct templateDb_s *next;
+};
+
+/****
+ *
+ * external variables
+ *
+ ****/
+
+extern struct templateDb_s *templateDbs;
+
+/****
+ *
+ * function prototypes
+ *
+ ****/
+
+int loadTemplateDb(const char *fName);
+int templateDbLoaded(const char *fName);
+int templateDbLookup(const char *template, size_t templateLen, uint64_t hash);
+int writeTemplateDb(FILE *outFile, struct hash_s *hash);
+void closeTemplateDbs(void);
+
+/****
+ *
+ * TRUE when a template (templateLen counts its nul) is in a database
+ * loaded with -t, costs a pointer test when none is
+ *
+ ****/
+
+static inline int inTemplateDb(const char *template, size_t templateLen, uint64_t hash)
+{
+  return ((templateDbs != NULL) && templateDbLookup(template, templateLen, hash));
+}
+
+#endif /* TEMPLATEDB_DOT_H */
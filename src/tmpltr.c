@@ -28,6 +28,7 @@
 
 #include "tmpltr.h"
 #include "parser_interface.h"
+#include "pipeline.h"
 
 /****
  *
@@ -44,8 +45,26 @@
 /* hashes */
 struct hash_s *templateHash = NULL;
 
+/* template records and sample lines, see newMetaData() */
+PRIVATE struct mdBlock_s *mdBlocks = NULL;
+
+/* -w template file while the report is written */
+PRIVATE output_t *templateOut = NULL;
+
+/* lines stored so far, orders templates by first sighting */
+uint64_t inputSeq = 0;
+
+/* sorted report, traverseHash() callbacks take no context */
+PRIVATE struct sortRec_s *sortRecs = NULL;
+PRIVATE size_t sortCount = 0;
+PRIVATE size_t sortSize = 0;
+PRIVATE size_t sortLimit = 0;              /* heap size for --top / --bottom, 0 keeps all */
+
 /* parser interface */
 PRIVATE ParserInterface *current_parser = NULL;
+#ifdef DEBUG
+PRIVATE unsigned int argCount = 0;
+#endif
 
 /****
  *
@@ -56,6 +75,7 @@ PRIVATE ParserInterface *current_parser = NULL;
 extern Config_t *config;
 extern int quit;
 extern int reload;
+extern output_t *reportOut;
 
 /****
  * secure file open with symlink protection
@@ -115,6 +135,28 @@ PRIVATE FILE *secure_fopen(const char *path, const char *mode)
  *
  ****/
 
+/****
+ *
+ * append the -e estimate of a variable field, {~count}
+ *
+ ****/
+
+PRIVATE int appendEstimate(char *oBuf, int wPos, int bufSize, const struct Fields_s *field)
+{
+  int written;
+
+  if (!config->estimate)
+    return wPos;
+
+  written = snprintf(oBuf + wPos, bufSize - wPos, "{~%lu}", (unsigned long)hllEstimate(&field->hll));
+  if ((written > 0) && (written < bufSize - wPos))
+    return wPos + written;
+
+  /* drop a truncated estimate */
+  oBuf[wPos] = '\0';
+  return wPos;
+}
+
 /****
  *
  * assemble clustered template string
@@ -124,7 +166,7 @@ PRIVATE FILE *secure_fopen(const char *path, const char *mode)
 char *clusterTemplate(char *template, metaData_t *md, char *oBuf, int bufSize)
 {
   int i, rPos = 0, wPos = 0, done;
-  struct Fields_s *curFieldPtr = md->head;
+  struct Fields_s *curFieldPtr = md->fields, *endFieldPtr = md->fields + md->fieldCount;
 
   /* Ensure we have space for at least null terminator */
   if (bufSize <= 0) {
@@ -135,7 +177,7 @@ char *clusterTemplate(char *template, metaData_t *md, char *oBuf, int bufSize)
   oBuf[0] = '\0';
 
   /* loop through the field argument trees */
-  while ((curFieldPtr != NULL) && (wPos < bufSize - 1))
+  while ((curFieldPtr < endFieldPtr) && (wPos < bufSize - 1))
   {
     /* find next variable */
     done = FALSE;
@@ -171,43 +213,24 @@ char *clusterTemplate(char *template, metaData_t *md, char *oBuf, int bufSize)
             if (wPos < bufSize - 2) {
               oBuf[wPos++] = template[rPos++];
               oBuf[wPos++] = template[rPos++];
+              wPos = appendEstimate(oBuf, wPos, bufSize, curFieldPtr);
             } else {
               done = TRUE; /* Buffer full */
             }
             done = TRUE;
           }
-          /* Only substitute if field is invariant (has exactly one unique value) */
-          else if (curFieldPtr->count == 1) {
-            /* Get first value based on storage type */
-            const char *firstValue = NULL;
-            switch (curFieldPtr->storage_type) {
-              case FIELD_STORAGE_INLINE:
-                firstValue = curFieldPtr->storage.inline_values[0];
-                break;
-              case FIELD_STORAGE_DYNAMIC:
-                firstValue = curFieldPtr->storage.dynamic.values[0];
-                break;
-              case FIELD_STORAGE_HASHSET:
-                /* For hash set, we need to find the first non-null bucket */
-                if (curFieldPtr->storage.hashset) {
-                  uint32_t j;
-                  for (j = 0; j < curFieldPtr->storage.hashset->capacity; j++) {
-                    if (curFieldPtr->storage.hashset->buckets[j] != NULL) {
-                      firstValue = curFieldPtr->storage.hashset->buckets[j];
-                      break;
-                    }
-                  }
-                }
-                break;
-            }
-            
+          /* Only substitute if field is invariant (has exactly one unique value), the estimate also covers later occurrences */
+          else if ((curFieldPtr->count == 1) && (!config->estimate || (hllEstimate(&curFieldPtr->hll) <= 1))) {
+            /* the first value is kept while the field is invariant */
+            const char *firstValue = curFieldPtr->value;
+
             if (firstValue)
             {
             /* move past the place holder */
             rPos += 2;
             
-            /* Copy field value with bounds checking - skip type prefix */
-            const char *fieldValue = firstValue + 1;
+            /* Copy field value with bounds checking */
+            const char *fieldValue = firstValue;
             for (i = 0; fieldValue[i] != 0 && wPos < bufSize - 1; i++)
             {
               if (isprint(fieldValue[i]))
@@ -243,6 +266,7 @@ char *clusterTemplate(char *template, metaData_t *md, char *oBuf, int bufSize)
             if (wPos < bufSize - 2) {
               oBuf[wPos++] = template[rPos++];
               oBuf[wPos++] = template[rPos++];
+              wPos = appendEstimate(oBuf, wPos, bufSize, curFieldPtr);
             } else {
               done = TRUE; /* Buffer full */
             }
@@ -269,7 +293,7 @@ char *clusterTemplate(char *template, metaData_t *md, char *oBuf, int bufSize)
         }
       }
     }
-    curFieldPtr = curFieldPtr->next;
+    curFieldPtr++;
   }
 
   /* copy the rest of the characters with bounds checking */
@@ -282,6 +306,56 @@ char *clusterTemplate(char *template, metaData_t *md, char *oBuf, int bufSize)
   return (oBuf);
 }
 
+/****
+ *
+ * write one report line, count template||sample line
+ *
+ ****/
+
+PRIVATE void writeReportLine(const struct hashRec_s *hashRec)
+{
+  metaData_t *tmpMd = (metaData_t *)hashRec->data;
+  char oBuf[MAX_FIELD_LEN];
+
+  writeOutputCount(reportOut, tmpMd->count, 12);
+  writeOutput(reportOut, " ", 1);
+  if (config->cluster)
+    writeOutputString(reportOut, clusterTemplate(hashRec->keyString, tmpMd, oBuf, sizeof(oBuf)));
+  else
+    writeOutputString(reportOut, hashRec->keyString);
+
+  /* a clustered template seen once is its own example */
+  if (!config->cluster || (tmpMd->count > 1))
+  {
+    writeOutput(reportOut, "||", 2);
+    writeOutputString(reportOut, tmpMd->lBuf);
+  }
+  else
+    writeOutput(reportOut, "\n", 1);
+}
+
+/****
+ *
+ * free the per field records of a template
+ *
+ ****/
+
+PRIVATE int freeTemplateFields(const struct hashRec_s *hashRec)
+{
+  metaData_t *tmpMd = (metaData_t *)hashRec->data;
+  uint32_t i;
+
+  if (tmpMd == NULL)
+    return FALSE;
+
+  /* the array lives with the record, only the field storage is freed */
+  for (i = 0; i < tmpMd->fieldCount; i++)
+    freeField(&tmpMd->fields[i]);
+  tmpMd->fieldCount = 0;
+
+  return FALSE;
+}
+
 /****
  *
  * print all template records in hash
@@ -290,10 +364,6 @@ char *clusterTemplate(char *template, metaData_t *md, char *oBuf, int bufSize)
 
 int printTemplate(const struct hashRec_s *hashRec)
 {
-  metaData_t *tmpMd;
-  struct Fields_s *curFieldPtr, *tmpFieldPtr;
-  char oBuf[MAX_FIELD_LEN];
-  
 
 #ifdef DEBUG
   if (config->debug >= 3)
@@ -302,46 +372,235 @@ int printTemplate(const struct hashRec_s *hashRec)
 
   if (hashRec->data != NULL)
   {
-    tmpMd = (metaData_t *)hashRec->data;
     /* save template if -w was used */
-    if (config->outFile_st != NULL)
-      fprintf(config->outFile_st, "%s\n", hashRec->keyString);
-
-    if (config->cluster)
+    if (templateOut != NULL)
     {
-      if (tmpMd->count > 1)
-        printf("%12lu %s||%s", tmpMd->count, clusterTemplate(hashRec->keyString, tmpMd, oBuf, sizeof(oBuf)), tmpMd->lBuf);
-      else
-        printf("%12lu %s\n", tmpMd->count, clusterTemplate(hashRec->keyString, tmpMd, oBuf, sizeof(oBuf)));
+      writeOutputString(templateOut, hashRec->keyString);
+      writeOutput(templateOut, "\n", 1);
     }
-    else
-      printf("%12lu %s||%s", tmpMd->count, hashRec->keyString, tmpMd->lBuf);
+
+    writeReportLine(hashRec);
 
     /* cleanup after clustering */
-    if (config->cluster)
+    if (config->cluster && config->teardown)
+      freeTemplateFields(hashRec);
+  }
+
+  /* can use this later to interrupt traversing the hash */
+  if (quit)
+    return (TRUE);
+  return (FALSE);
+}
+
+/****
+ *
+ * new template record holding a copy of its sample line
+ *
+ * DESCRIPTION:
+ *   Records are carved out of MD_BLOCK_SIZE blocks with the line stored
+ *   right behind the record at its own length, a template costs a few
+ *   dozen bytes plus its line instead of a LINEBUF_SIZE buffer.  Lines
+ *   are cut at LINEBUF_SIZE - 1 bytes or the first nul.  The field
+ *   array and its tracking bitset follow the line, so clustering needs
+ *   no allocation per field.
+ *
+ * RETURNS:
+ *   zeroed record with lBuf set and fieldCount fields tracking, NULL
+ *   when out of memory.  Records are never freed on their own,
+ *   freeMetaData() releases all of them.
+ *
+ ****/
+
+metaData_t *newMetaData(const char *line, size_t len, uint32_t fieldCount)
+{
+  struct mdBlock_s *block = mdBlocks;
+  metaData_t *md;
+  size_t lLen, need, lineEnd, words = FIELD_BITSET_WORDS(fieldCount);
+  uint32_t i;
+
+  lLen = strnlen(line, (len < LINEBUF_SIZE - 1) ? len : LINEBUF_SIZE - 1);
+  /* keep the fields and the next record pointer aligned */
+  lineEnd = (sizeof(metaData_t) + lLen + 1 + (sizeof(uint64_t) - 1)) & ~(sizeof(uint64_t) - 1);
+  need = lineEnd + (sizeof(struct Fields_s) * fieldCount) + (sizeof(uint64_t) * words);
+
+  if ((block == NULL) || (block->used + need > block->size))
+  {
+    size_t size = (need > MD_BLOCK_SIZE) ? need : MD_BLOCK_SIZE;
+
+    if ((block = (struct mdBlock_s *)XMALLOC(sizeof(struct mdBlock_s) + size)) == NULL)
+      return NULL;
+    block->size = size;
+    block->used = 0;
+    block->next = mdBlocks;
+    mdBlocks = block;
+  }
+
+  md = (metaData_t *)(void *)(block->data + block->used);
+  block->used += need;
+
+  md->count = 0;
+  md->fieldCount = fieldCount;
+  md->fields = (struct Fields_s *)(void *)((char *)md + lineEnd);
+  md->tracking = (uint64_t *)(void *)(md->fields + fieldCount);
+  for (i = 0; i < fieldCount; i++)
+    initField(&md->fields[i]);
+  XMEMSET(md->tracking, 0xff, sizeof(uint64_t) * words);
+  if (fieldCount & 63)
+    md->tracking[words - 1] = (1ULL << (fieldCount & 63)) - 1;
+  md->all_fields_stopped_tracking = (fieldCount == 0);
+  md->template_complete = 0;
+  memcpy(md->lBuf, line, lLen);
+  md->lBuf[lLen] = '\0';
+
+  return md;
+}
+
+/****
+ *
+ * free every record handed out by newMetaData()
+ *
+ ****/
+
+void freeMetaData(void)
+{
+  struct mdBlock_s *block;
+
+  while ((block = mdBlocks) != NULL)
+  {
+    mdBlocks = block->next;
+    XFREE(block);
+  }
+}
+
+/****
+ *
+ * add a parsed line to the template hash
+ *
+ * returns TRUE when the line produced a new template, FALSE when the
+ * template was already known and FAILED on error
+ *
+ ****/
+
+int storeTemplate(ParserInterface *parser, parser_ctx_t *ctx, int fieldCount, char *line, size_t len)
+{
+  const char *template;
+  struct hashRec_s *tmpRec;
+  metaData_t *tmpMd;
+  parser_field_t field;
+  uint32_t i, fields;
+  int templateLen, ret = FALSE;
+
+  /* the first field is the generated template */
+  getParserField(parser, ctx, 0, &field);
+  template = field.ptr;
+  templateLen = field.len + 1;
+  inputSeq++;
+
+  /* known from a template database loaded with -t */
+  if (inTemplateDb(template, (size_t)templateLen, field.hash))
+    return (FALSE);
+
+  /* load it into the hash */
+  if ((tmpRec = getHashRecordWithHash(templateHash, template, templateLen, field.hash)) == NULL)
+  { /* new template */
+    ret = TRUE;
+
+#ifdef DEBUG
+    if (config->debug >= 3)
+      printf("%s||%.*s", template, (int)len, line);
+#endif
+
+    /* store line metadata, with a field array when clustering */
+    fields = (config->cluster && (fieldCount > 1)) ? (uint32_t)(fieldCount - 1) : 0;
+    if ((tmpMd = newMetaData(line, len, fields)) == NULL)
     {
-      if (tmpMd != NULL)
-        curFieldPtr = tmpMd->head;
-      else
-        curFieldPtr = NULL;
+      fprintf(stderr, "ERR - Unable to allocate template record\n");
+      return FAILED;
+    }
+    tmpMd->count = 1;
+    tmpMd->firstSeen = inputSeq;
 
-      /* free per field records and arrays */
-      while (curFieldPtr != NULL)
+    /* stuff the new record into the hash before processing fields */
+    if ((tmpRec = addUniqueHashRecWithHash(templateHash, template, templateLen, field.hash, tmpMd)) == NULL)
+    {
+      fprintf(stderr, "ERR - Unable to add hash record\n");
+      ret = FAILED;
+    }
+    else
+    {
+      /* process arguments if clustering is enabled */
+      if (config->cluster)
       {
-        tmpFieldPtr = curFieldPtr;
-        curFieldPtr = curFieldPtr->next;
-        freeField(tmpFieldPtr);
-        XFREE(tmpFieldPtr);
+        for (i = 0; i < tmpMd->fieldCount; i++)
+        {
+          getParserField(parser, ctx, i + 1, &field);
+
+          /* XXX removing chain stubs and moving to a separate tool */
+#ifdef DEBUG
+          if (config->debug >= 4)
+            printf("DEBUG - Storing argument [%.*s]\n", (int)field.len, field.ptr);
+#endif
+
+          trackFieldValueLen(tmpMd, i, field.ptr, field.len);
+          if (config->estimate)
+            hllAdd(&tmpMd->fields[i].hll, hashKey(field.ptr, (int)field.len));
+#ifdef DEBUG
+          if (config->debug)
+            argCount++;
+#endif
+        }
       }
     }
+    /* grow the hash if load factor exceeds 0.75 for better performance */
+    if (templateHash->totalRecords * 4 > templateHash->size * 3)
+      templateHash = dyGrowHash(templateHash);
+  }
+  else
+  {
+
+    if (tmpRec->data != NULL)
+    {
+      tmpMd = (metaData_t *)tmpRec->data;
+      tmpMd->count++;
+
+#ifdef DEBUG
+      if (config->debug >= 3)
+        printf("DEBUG - Updating existing template\n");
+#endif
+
+      /* process arguments if clustering is enabled - only for first few occurrences
+         of templates with fields still tracking, every one feeds the estimates */
+      if (config->cluster && (((tmpMd->count <= (size_t)config->clusterDepth) && !tmpMd->all_fields_stopped_tracking) || config->estimate))
+      {
+        for (i = 0; (i < tmpMd->fieldCount) && (i + 1 < (uint32_t)fieldCount); i++)
+        {
+          /* fields that proved variable have nothing left to track */
+          if (!config->estimate && !fieldTracking(tmpMd, i))
+            continue;
+
+          getParserField(parser, ctx, i + 1, &field);
+
+#ifdef DEBUG
+          if (config->debug >= 4)
+            printf("DEBUG - Processing argument [%.*s]\n", (int)field.len, field.ptr);
+#endif
 
-    XFREE(tmpMd);
+          /* Track field value using efficient array-based approach */
+          if ((tmpMd->count <= (size_t)config->clusterDepth) && (trackFieldValueLen(tmpMd, i, field.ptr, field.len) == 1))
+          {
+#ifdef DEBUG
+            if (config->debug)
+              argCount++;
+#endif
+          }
+          if (config->estimate)
+            hllAdd(&tmpMd->fields[i].hll, hashKey(field.ptr, (int)field.len));
+        }
+      }
+    }
   }
 
-  /* can use this later to interrupt traversing the hash */
-  if (quit)
-    return (TRUE);
-  return (FALSE);
+  return (ret);
 }
 
 /****
@@ -352,24 +611,23 @@ int printTemplate(const struct hashRec_s *hashRec)
 
 int processFile(const char *fName)
 {
-  FILE *inFile = NULL;
-  char inBuf[65536];  /* 64KB buffer for better I/O performance */
-  char oBuf[8192];
-  PRIVATE int i, ret;
+  input_t *in;
+  char *line;
+  size_t len;
+  int ret, mapped;
   unsigned int lineCount = 0;
 #ifdef DEBUG
-  unsigned int lineLen = 0, minLineLen = sizeof(inBuf), maxLineLen = 0, totLineLen = 0;
-  unsigned int argCount = 0, totArgCount = 0, minArgCount = MAX_FIELD_POS, maxArgCount = 0;
+  unsigned int lineLen = 0, minLineLen = INPUT_MAX_LINE, maxLineLen = 0, totLineLen = 0;
+  unsigned int totArgCount = 0, minArgCount = MAX_FIELD_POS, maxArgCount = 0;
 #endif
-  struct hashRec_s *tmpRec;
-  metaData_t *tmpMd;
-  struct Fields_s **curFieldPtr;
+  parser_ctx_t *ctx;
+  parser_field_t field;
 
   /* initialize the hash if we need to */
   if (templateHash == NULL) {
     /* Use larger initial size for clustering to reduce early hash collisions */
     size_t initial_size = config->cluster ? 12289 : 389;  /* 12K vs 389 entries */
-    templateHash = initHash(initial_size);
+    templateHash = initSwissHash(initial_size);
   }
 
   /* get and initialize the selected parser */
@@ -382,27 +640,36 @@ int processFile(const char *fName)
   if (config->debug >= 2) {
     fprintf(stderr, "DEBUG - Using parser: %s\n", current_parser->name);
   }
-  
-  current_parser->init();
 
 #ifdef DEBUG
   if (config->debug >= 1)
     fprintf(stderr, "Opening [%s] for read\n", fName);
 #endif
-  if (strcmp(fName, "-") == 0)
+  /* regular files are mapped, stdin and pipes are streamed */
+  if ((in = openInput(fName)) == NULL)
+  {
+    fprintf(stderr, "ERR - Unable to open file [%s] %d (%s)\n", fName, errno, strerror(errno));
+    return (EXIT_FAILURE);
+  }
+  mapped = inputIsMapped(in);
+
+#ifdef HAVE_PTHREAD_H
+  /* match mode prints lines in input order, keep it on this thread */
+  if ((config->threads > 1) && !config->match)
   {
-    inFile = stdin;
+    ret = pipelineProcessFile(in, current_parser);
+    closeInput(in);
+    return ((ret == TRUE) ? EXIT_SUCCESS : EXIT_FAILURE);
   }
-  else
+#endif
+
+  if ((ctx = current_parser->init()) == NULL)
   {
-    if ((inFile = secure_fopen(fName, "r")) == NULL)
-    {
-      fprintf(stderr, "ERR - Unable to open file [%s] %d (%s)\n", fName, errno, strerror(errno));
-      return (EXIT_FAILURE);
-    }
+    closeInput(in);
+    return (EXIT_FAILURE);
   }
 
-  while (fgets(inBuf, sizeof(inBuf), inFile) != NULL && !quit)
+  while (!quit && readInputLine(in, &line, &len))
   {
     
     if (reload == TRUE)
@@ -423,7 +690,7 @@ int processFile(const char *fName)
           argCount = 0;
         }
 
-        minLineLen = sizeof(inBuf);
+        minLineLen = INPUT_MAX_LINE;
         maxLineLen = 0;
         totLineLen = 0;
       }
@@ -435,7 +702,7 @@ int processFile(const char *fName)
 #ifdef DEBUG
     if (config->debug)
     {
-      lineLen = strlen(inBuf);
+      lineLen = (unsigned int)len;
       totLineLen += lineLen;
       if (lineLen < minLineLen)
         minLineLen = lineLen;
@@ -445,9 +712,9 @@ int processFile(const char *fName)
 #endif
 
     if (config->debug >= 3)
-      printf("DEBUG - Before [%s]", inBuf);
+      printf("DEBUG - Before [%.*s]", (int)len, line);
 
-    if ((ret = current_parser->parseLine(inBuf)) > 0)
+    if ((ret = current_parser->parseLine(ctx, line, (int)len)) > 0)
     {
 
 #ifdef DEBUG
@@ -462,119 +729,21 @@ int processFile(const char *fName)
       }
 #endif
 
-      /* the first field is the generated template */
-      current_parser->getParsedField(oBuf, sizeof(oBuf), 0);
-      int templateLen = strlen(oBuf) + 1;
-
       if (config->match)
       {
-        if (templateMatches(oBuf))
-          printf("%s", inBuf);
-      }
-      else
-      {
-        /* load it into the hash */
-        if ((tmpRec = getHashRecord(templateHash, oBuf, templateLen)) == NULL)
-        { /* new template */
-
-#ifdef DEBUG
-          if (config->debug >= 3)
-            printf("%s||%s", oBuf, inBuf);
-#endif
-
-          /* store line metadata */
-          tmpMd = (metaData_t *)XMALLOC(sizeof(metaData_t));
-          XMEMSET(tmpMd, 0, sizeof(metaData_t));
-          tmpMd->count = 1;
-          tmpMd->all_fields_stopped_tracking = 0;
-          tmpMd->template_complete = 0;
-          XSTRNCPY(tmpMd->lBuf, inBuf, LINEBUF_SIZE);
-
-          /* stuff the new record into the hash before processing fields */
-          if ((tmpRec = addUniqueHashRec(templateHash, oBuf, templateLen, tmpMd)) == NULL)
-          {
-            fprintf(stderr, "ERR - Unable to add hash record\n");
-          }
-          else
-          {
-            /* process arguments if clustering is enabled */
-            if (config->cluster)
-            {
-              curFieldPtr = &tmpMd->head;
-              for (i = 1; i < ret; i++)
-              {
-                current_parser->getParsedField(inBuf, sizeof(inBuf), i);
-
-                /* XXX removing chain stubs and moving to a separate tool */
-#ifdef DEBUG
-                if (config->debug >= 4)
-                  printf("DEBUG - Storing argument [%s]\n", inBuf);
-#endif
-
-                if (*curFieldPtr == NULL)
-                {
-                  *curFieldPtr = (struct Fields_s *)XMALLOC(sizeof(struct Fields_s));
-                  initField(*curFieldPtr);
-                }
-                trackFieldValue(*curFieldPtr, inBuf);
-#ifdef DEBUG
-                if (config->debug)
-                  argCount++;
-#endif
-                curFieldPtr = &(*curFieldPtr)->next;
-              }
-            }
-          }
-          /* grow the hash if load factor exceeds 0.75 for better performance */
-          if (templateHash->totalRecords * 4 > templateHash->size * 3)
-            templateHash = dyGrowHash(templateHash);
-        }
-        else
+        /* the first field is the generated template */
+        getParserField(current_parser, ctx, 0, &field);
+        if (templateMatches(field.ptr, field.len, field.hash))
         {
-
-          if (tmpRec->data != NULL)
-          {
-            tmpMd = (metaData_t *)tmpRec->data;
-            tmpMd->count++;
-
-#ifdef DEBUG
-            if (config->debug >= 3)
-              printf("DEBUG - Updating existing template\n");
-#endif
-
-            /* process arguments if clustering is enabled - only for first few occurrences */
-            if (config->cluster && tmpMd->count <= config->clusterDepth)
-            {
-              curFieldPtr = &tmpMd->head;
-              for (i = 1; i < ret; i++)
-              {
-                current_parser->getParsedField(inBuf, sizeof(inBuf), i);
-
-#ifdef DEBUG
-                if (config->debug >= 4)
-                  printf("DEBUG - Processing argument [%s]\n", inBuf);
-#endif
-
-                if (*curFieldPtr == NULL)
-                {
-                  *curFieldPtr = (struct Fields_s *)XMALLOC(sizeof(struct Fields_s));
-                  initField(*curFieldPtr);
-                }
-
-                /* Track field value using efficient array-based approach */
-                if (trackFieldValue(*curFieldPtr, inBuf) == 1)
-                {
-#ifdef DEBUG
-                  if (config->debug)
-                    argCount++;
-#endif
-                }
-                curFieldPtr = &(*curFieldPtr)->next;
-              }
-            }
-          }
+          /* mapped lines stay put until closeInput(), write them from there */
+          if (mapped)
+            writeOutputRef(reportOut, line, len);
+          else
+            writeOutput(reportOut, line, len);
         }
       }
+      else
+        storeTemplate(current_parser, ctx, ret, line, len);
       lineCount++;
     }
   }
@@ -594,22 +763,252 @@ int processFile(const char *fName)
       argCount = 0;
     }
 
-    minLineLen = sizeof(inBuf);
+    minLineLen = INPUT_MAX_LINE;
     maxLineLen = 0;
     totLineLen = 0;
   }
 #endif
 
-  if (inFile != stdin)
-    fclose(inFile);
+  /* matched lines may still point into the input */
+  flushOutput(reportOut);
+  closeInput(in);
 
-  if (current_parser != NULL) {
-    current_parser->deinit();
-  }
+  current_parser->deinit(ctx);
 
   return (EXIT_SUCCESS);
 }
 
+/****
+ *
+ * TRUE when a is ahead of b in a --top (most seen) or --bottom (least
+ * seen) ranking, the template seen first wins a tie
+ *
+ ****/
+
+PRIVATE int ranksAhead(const struct hashRec_s *a, const struct hashRec_s *b)
+{
+  const metaData_t *mdA = (const metaData_t *)a->data;
+  const metaData_t *mdB = (const metaData_t *)b->data;
+
+  if (mdA->count != mdB->count)
+    return (config->topCount > 0) ? (mdA->count > mdB->count) : (mdA->count < mdB->count);
+  return (mdA->firstSeen < mdB->firstSeen);
+}
+
+/****
+ *
+ * restore the heap below pos, the root is the kept template that
+ * ranks last
+ *
+ ****/
+
+PRIVATE void siftDownRank(struct sortRec_s *heap, size_t count, size_t pos)
+{
+  struct sortRec_s tmp;
+  size_t child;
+
+  while ((child = (pos * 2) + 1) < count)
+  {
+    if ((child + 1 < count) && ranksAhead(heap[child].rec, heap[child + 1].rec))
+      child++;
+    if (!ranksAhead(heap[pos].rec, heap[child].rec))
+      break;
+    tmp = heap[pos];
+    heap[pos] = heap[child];
+    heap[child] = tmp;
+    pos = child;
+  }
+}
+
+/****
+ *
+ * gather the templates to report, keeping only the best sortLimit
+ * when --top or --bottom is set
+ *
+ ****/
+
+PRIVATE int collectTemplate(const struct hashRec_s *hashRec)
+{
+  struct sortRec_s tmp;
+  size_t pos, parent;
+
+  /* templates loaded with -t have no metadata */
+  if (hashRec->data == NULL)
+    return FALSE;
+
+  /* -w gets every template, not only the reported ones */
+  if (templateOut != NULL)
+  {
+    writeOutputString(templateOut, hashRec->keyString);
+    writeOutput(templateOut, "\n", 1);
+  }
+
+  if ((sortLimit == 0) || (sortCount < sortLimit))
+  {
+    if (sortCount == sortSize)
+    {
+      sortSize *= 2;
+      sortRecs = (struct sortRec_s *)XREALLOC(sortRecs, sizeof(struct sortRec_s) * sortSize);
+    }
+    pos = sortCount++;
+    sortRecs[pos].rec = hashRec;
+    if (sortLimit == 0)
+      return FALSE;
+
+    /* sift up */
+    while ((pos > 0) && ranksAhead(sortRecs[parent = (pos - 1) / 2].rec, sortRecs[pos].rec))
+    {
+      tmp = sortRecs[pos];
+      sortRecs[pos] = sortRecs[parent];
+      sortRecs[parent] = tmp;
+      pos = parent;
+    }
+  }
+  else if (ranksAhead(hashRec, sortRecs[0].rec))
+  {
+    sortRecs[0].rec = hashRec;
+    siftDownRank(sortRecs, sortCount, 0);
+  }
+
+  return FALSE;
+}
+
+/****
+ *
+ * stable LSD radix sort on key
+ *
+ * digits every key has in common are skipped, small counts and line
+ * numbers only take a pass or two
+ *
+ ****/
+
+PRIVATE void radixSortRecs(struct sortRec_s *recs, struct sortRec_s *tmp, size_t count)
+{
+  size_t hist[SORT_RADIX_SIZE];
+  struct sortRec_s *src = recs, *dst = tmp, *swap;
+  uint64_t maxKey = 0;
+  size_t i, sum, n;
+  int shift;
+
+  for (i = 0; i < count; i++)
+    if (recs[i].key > maxKey)
+      maxKey = recs[i].key;
+
+  for (shift = 0; (shift < 64) && ((maxKey >> shift) != 0); shift += SORT_RADIX_BITS)
+  {
+    XMEMSET(hist, 0, sizeof(hist));
+    for (i = 0; i < count; i++)
+      hist[(src[i].key >> shift) & (SORT_RADIX_SIZE - 1)]++;
+    if (hist[(src[0].key >> shift) & (SORT_RADIX_SIZE - 1)] == count)
+      continue;
+
+    for (i = 0, sum = 0; i < SORT_RADIX_SIZE; i++)
+    {
+      n = hist[i];
+      hist[i] = sum;
+      sum += n;
+    }
+    for (i = 0; i < count; i++)
+      dst[hist[(src[i].key >> shift) & (SORT_RADIX_SIZE - 1)]++] = src[i];
+
+    swap = src;
+    src = dst;
+    dst = swap;
+  }
+
+  if (src != recs)
+    XMEMCPY(recs, src, sizeof(struct sortRec_s) * count);
+}
+
+/****
+ *
+ * qsort() compare for --sort template
+ *
+ ****/
+
+PRIVATE int compareTemplates(const void *a, const void *b)
+{
+  return strcmp(((const struct sortRec_s *)a)->rec->keyString, ((const struct sortRec_s *)b)->rec->keyString);
+}
+
+/****
+ *
+ * print templates in --sort order, or only the --top / --bottom ones
+ *
+ * DESCRIPTION:
+ *   Templates are gathered into an array of records, a bounded heap
+ *   when only the top or bottom n by count are wanted.  Counts and
+ *   first sightings are sorted with a radix sort, a count sort is done
+ *   on first sightings first so equal counts stay in the order they
+ *   were first seen.  Without --sort a --top / --bottom list is printed
+ *   best first.
+ *
+ * RETURNS:
+ *   EXIT_SUCCESS or EXIT_FAILURE
+ *
+ ****/
+
+PRIVATE int showSortedTemplates(void)
+{
+  struct sortRec_s *tmp, swap;
+  size_t i, n;
+
+  sortLimit = (config->topCount > 0) ? (size_t)config->topCount : (size_t)config->bottomCount;
+  sortSize = templateHash->totalRecords + 1;
+  if ((sortLimit > 0) && (sortLimit < sortSize))
+    sortSize = sortLimit;
+  sortCount = 0;
+  if ((sortRecs = (struct sortRec_s *)XMALLOC(sizeof(struct sortRec_s) * sortSize)) == NULL)
+  {
+    fprintf(stderr, "ERR - Unable to allocate sort buffer\n");
+    return (EXIT_FAILURE);
+  }
+
+  traverseHash(templateHash, collectTemplate);
+
+  if (config->sortKey == SORT_NONE)
+  {
+    /* heap sort, the last ranked goes to the back */
+    for (n = sortCount; n > 1; n--)
+    {
+      swap = sortRecs[0];
+      sortRecs[0] = sortRecs[n - 1];
+      sortRecs[n - 1] = swap;
+      siftDownRank(sortRecs, n - 1, 0);
+    }
+  }
+  else if (config->sortKey == SORT_TEMPLATE)
+    qsort(sortRecs, sortCount, sizeof(struct sortRec_s), compareTemplates);
+  else if ((tmp = (struct sortRec_s *)XMALLOC(sizeof(struct sortRec_s) * (sortCount + 1))) != NULL)
+  {
+    for (i = 0; i < sortCount; i++)
+      sortRecs[i].key = ((const metaData_t *)sortRecs[i].rec->data)->firstSeen;
+    radixSortRecs(sortRecs, tmp, sortCount);
+    if (config->sortKey == SORT_COUNT)
+    {
+      for (i = 0; i < sortCount; i++)
+        sortRecs[i].key = ((const metaData_t *)sortRecs[i].rec->data)->count;
+      radixSortRecs(sortRecs, tmp, sortCount);
+    }
+    XFREE(tmp);
+  }
+  else
+    fprintf(stderr, "ERR - Unable to allocate sort buffer, templates are not sorted\n");
+
+  for (i = 0; (i < sortCount) && !quit; i++)
+    writeReportLine(sortRecs[i].rec);
+
+  if (config->teardown)
+  {
+    if (config->cluster)
+      traverseHash(templateHash, freeTemplateFields);
+    XFREE(sortRecs);
+    sortRecs = NULL;
+  }
+
+  return (quit ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
 /****
  *
  * print templates
@@ -618,6 +1017,7 @@ int processFile(const char *fName)
 
 int showTemplates(void)
 {
+  int ret = EXIT_FAILURE;
 
 #ifdef DEBUG
   if (config->debug >= 1)
@@ -626,16 +1026,32 @@ int showTemplates(void)
 
   if (templateHash != NULL)
   {
+    if ((config->outFile_st != NULL) && !config->writeDb)
+      templateOut = openOutput(fileno(config->outFile_st));
+
     /* dump the template data */
-    if (traverseHash(templateHash, printTemplate) == TRUE)
+    if ((config->sortKey != SORT_NONE) || (config->topCount > 0) || (config->bottomCount > 0))
+      ret = showSortedTemplates();
+    else if (traverseHash(templateHash, printTemplate) == TRUE)
+      ret = EXIT_SUCCESS;
+
+    closeOutput(templateOut);
+    templateOut = NULL;
+    flushOutput(reportOut);
+
+    if ((config->outFile_st != NULL) && config->writeDb && (writeTemplateDb(config->outFile_st, templateHash) != TRUE))
+      ret = EXIT_FAILURE;
+
+    /* without -X the records are left for the process exit */
+    if (config->teardown)
     {
       freeHash(templateHash);
-      return (EXIT_SUCCESS);
+      templateHash = NULL;
+      freeMetaData();
     }
-    freeHash(templateHash);
   }
 
-  return (EXIT_FAILURE);
+  return (ret);
 }
 
 /****
@@ -649,13 +1065,13 @@ int loadTemplateFile(const char *fName)
   FILE *inFile;
   char inBuf[65536];  /* 64KB buffer for better I/O performance */
   size_t count = 0;
-  int lLen, i;
+  int lLen, i, ret;
 
   /* init the hash if we need to */
   if (templateHash == NULL) {
     /* Use larger initial size for clustering to reduce early hash collisions */
     size_t initial_size = config->cluster ? 12289 : 389;
-    templateHash = initHash(initial_size);
+    templateHash = initSwissHash(initial_size);
   }
 
 #ifdef DEBUG
@@ -663,6 +1079,10 @@ int loadTemplateFile(const char *fName)
     printf("DEBUG - Loading template file [%s]\n", fName);
 #endif
 
+  /* a template database is mapped and queried in place */
+  if ((ret = loadTemplateDb(fName)) != FALSE)
+    return (ret);
+
   if ((inFile = secure_fopen(fName, "r")) == NULL)
   {
     fprintf(stderr, "ERR - Unable to open template file [%s]\n", fName);
@@ -710,13 +1130,13 @@ int loadTemplateFile(const char *fName)
  *
  * DESCRIPTION:
  *   Initializes a Fields_s structure for array-based value tracking.
- *   Sets up initial state with tracking enabled.
+ *   Whether the field is tracking lives in its template's bitset.
  *
  * PARAMETERS:
  *   field - Pointer to field structure to initialize
  *
  * SIDE EFFECTS:
- *   Zeros the field structure and enables tracking
+ *   Zeros the field structure
  *
  ****/
 void initField(struct Fields_s *field)
@@ -726,26 +1146,63 @@ void initField(struct Fields_s *field)
     
   field->count = 0;
   field->storage_type = FIELD_STORAGE_INLINE;  /* Start with inline storage */
-  field->is_variable = 0;
-  field->tracking_enabled = 1;
-  field->next = NULL;
+  field->value = NULL;
+  XMEMSET(&field->hll, 0, sizeof(field->hll));
   
   /* Initialize storage union */
   XMEMSET(&field->storage, 0, sizeof(field->storage));
 }
 
+/****
+ *
+ * Stop tracking a field that has shown enough values to be variable
+ *
+ ****/
+
+PRIVATE void stopTracking(metaData_t *md, uint32_t fieldNum)
+{
+  struct Fields_s *field = &md->fields[fieldNum];
+  size_t i, words = FIELD_BITSET_WORDS(md->fieldCount);
+
+  md->tracking[fieldNum >> 6] &= ~(1ULL << (fieldNum & 63));
+  for (i = 0; (i < words) && (md->tracking[i] == 0); i++)
+    ;
+  md->all_fields_stopped_tracking = (i == words);
+  field->value = NULL;
+
+  /* Aggressively free memory when tracking stops */
+  switch (field->storage_type) {
+    case FIELD_STORAGE_DYNAMIC:
+      if (field->storage.dynamic.values) {
+        XFREE(field->storage.dynamic.values);
+        field->storage.dynamic.values = NULL;
+      }
+      break;
+    case FIELD_STORAGE_HASHSET:
+      if (field->storage.hashset) {
+        field_hashset_destroy(field->storage.hashset);
+        field->storage.hashset = NULL;
+      }
+      break;
+  }
+  field->storage_type = FIELD_STORAGE_INLINE;
+}
+
 /****
  *
  * Track a field value using array-based approach
  *
  * DESCRIPTION:
- *   Tracks unique field values using a dynamic array instead of binary trees.
- *   Provides O(n) search but with excellent cache locality for small n.
- *   Automatically stops tracking when field becomes too variable.
+ *   Counts the distinct values of a field up to clusterDepth + 1, the
+ *   point where the field is known to be variable and tracking stops.
+ *   Values are compared by hash and length, only the first one is
+ *   interned since it is what an invariant field prints.
  *
  * PARAMETERS:
- *   field - Pointer to field structure
- *   value - String value to track
+ *   md - Template record
+ *   fieldNum - Field of the template, from 0
+ *   value - Value to track, need not be nul terminated
+ *   len - Length of value
  *
  * RETURNS:
  *   1 if value was added (new unique value)
@@ -753,73 +1210,39 @@ void initField(struct Fields_s *field)
  *   -1 on error
  *
  * PERFORMANCE:
- *   O(n) linear search but 3-6x faster than binary trees for small datasets
- *   due to cache locality and simplified operations
+ *   O(n) linear search over fixed size keys, no copy of the value
+ *   unless it is the first one
  *
  ****/
-/* Forward declarations removed - now in header file */
 
-int trackFieldValue(struct Fields_s *field, const char *value)
+int trackFieldValueLen(metaData_t *md, uint32_t fieldNum, const char *value, size_t len)
 {
   uint16_t i;
-  const char *internedValue;
+  struct Fields_s *field;
+  field_value_t key;
+  field_value_t temp_values[FIELD_INLINE_SIZE];
   string_intern_t *intern;
-  const char *temp_values[FIELD_INLINE_SIZE];
-  
-  if (field == NULL || value == NULL || !field->tracking_enabled)
-    return 0;
-  
-  /* Get global string interning system */
-  intern = getGlobalIntern();
-  if (!intern)
-    return -1;
-  
-  /* Intern the value for memory efficiency */
-  internedValue = internString(intern, value);
-  if (!internedValue)
-    return -1;
   
-  /* Stop tracking if we have enough unique values to determine variability */
-  /* Need at least 2 unique values to know if field is variable */
-  if (field->count > config->clusterDepth) {
-    field->is_variable = 1;
-    field->tracking_enabled = 0;
-    
-    /* Aggressively free memory when tracking stops */
-    switch (field->storage_type) {
-      case FIELD_STORAGE_DYNAMIC:
-        if (field->storage.dynamic.values) {
-          XFREE(field->storage.dynamic.values);
-          field->storage.dynamic.values = NULL;
-        }
-        break;
-      case FIELD_STORAGE_HASHSET:
-        if (field->storage.hashset) {
-          field_hashset_destroy(field->storage.hashset);
-          field->storage.hashset = NULL;
-        }
-        break;
-    }
-    field->storage_type = FIELD_STORAGE_INLINE;
-    field->count = 0;
-    
+  if (md == NULL || value == NULL || fieldNum >= md->fieldCount || !fieldTracking(md, fieldNum))
     return 0;
-  }
+  field = &md->fields[fieldNum];
   
+  key = FIELD_VALUE_KEY(hashKey(value, (int)len), len);
+
   /* Check based on storage type */
   switch (field->storage_type) {
     case FIELD_STORAGE_INLINE:
       /* Search inline array */
       for (i = 0; i < field->count; i++) {
-        if (field->storage.inline_values[i] == internedValue)
+        if (field->storage.inline_values[i] == key)
           return 0; /* Already exists */
       }
       
       /* Add to inline array if space available */
       if (field->count < FIELD_INLINE_SIZE) {
-        field->storage.inline_values[field->count] = internedValue;
+        field->storage.inline_values[field->count] = key;
         field->count++;
-        return 1;
+        break;
       }
       
       /* Need to upgrade to dynamic array */
@@ -829,7 +1252,7 @@ int trackFieldValue(struct Fields_s *field, const char *value)
       
       /* Allocate dynamic array */
       field->storage.dynamic.capacity = 16;
-      field->storage.dynamic.values = (const char **)XMALLOC(sizeof(const char *) * field->storage.dynamic.capacity);
+      field->storage.dynamic.values = (field_value_t *)XMALLOC(sizeof(field_value_t) * field->storage.dynamic.capacity);
       if (!field->storage.dynamic.values)
         return -1;
       
@@ -839,15 +1262,15 @@ int trackFieldValue(struct Fields_s *field, const char *value)
       }
       
       /* Add new value */
-      field->storage.dynamic.values[field->count] = internedValue;
+      field->storage.dynamic.values[field->count] = key;
       field->count++;
       field->storage_type = FIELD_STORAGE_DYNAMIC;
-      return 1;
+      break;
       
     case FIELD_STORAGE_DYNAMIC:
       /* Search dynamic array */
       for (i = 0; i < field->count; i++) {
-        if (field->storage.dynamic.values[i] == internedValue)
+        if (field->storage.dynamic.values[i] == key)
           return 0; /* Already exists */
       }
       
@@ -871,19 +1294,18 @@ int trackFieldValue(struct Fields_s *field, const char *value)
         field->storage_type = FIELD_STORAGE_HASHSET;
         
         /* Add new value */
-        if (field_hashset_contains_or_add(hs, internedValue)) {
-          field->count++;
-          return 1;
-        }
-        return 0;
+        if (!field_hashset_contains_or_add(hs, key))
+          return 0;
+        field->count++;
+        break;
       }
       
       /* Add to dynamic array */
       if (field->count >= field->storage.dynamic.capacity) {
         /* Need to grow */
         uint16_t new_capacity = field->storage.dynamic.capacity * 2;
-        const char **new_values = (const char **)XREALLOC(field->storage.dynamic.values,
-                                                          sizeof(const char *) * new_capacity);
+        field_value_t *new_values = (field_value_t *)XREALLOC(field->storage.dynamic.values,
+                                                              sizeof(field_value_t) * new_capacity);
         if (!new_values)
           return -1;
         
@@ -891,39 +1313,55 @@ int trackFieldValue(struct Fields_s *field, const char *value)
         field->storage.dynamic.capacity = new_capacity;
       }
       
-      field->storage.dynamic.values[field->count] = internedValue;
+      field->storage.dynamic.values[field->count] = key;
       field->count++;
-      return 1;
+      break;
       
     case FIELD_STORAGE_HASHSET:
       /* Use hash set for O(1) lookup */
-      if (field_hashset_contains_or_add(field->storage.hashset, internedValue)) {
-        field->count++;
-        return 1;
-      }
-      return 0;
+      if (!field_hashset_contains_or_add(field->storage.hashset, key))
+        return 0;
+      field->count++;
+      break;
       
     default:
       return -1; /* Invalid storage type */
   }
+
+  /* Keep the value an invariant field prints */
+  if (field->count == 1) {
+    if ((intern = getGlobalIntern()) == NULL)
+      return -1;
+    if ((field->value = internStringLen(intern, value, len)) == NULL)
+      return -1;
+  }
+
+  /* Need more than clusterDepth unique values to know the field is variable */
+  if (field->count > (uint32_t)config->clusterDepth)
+    stopTracking(md, fieldNum);
+
+  return 1;
 }
 
 /****
  *
- * Hash set implementation for field value tracking
+ * Track a nul terminated field value
  *
  ****/
 
-/* FNV-1a hash function for interned strings */
-static uint32_t field_hash_string(const char *str) {
-  uint32_t hash = 2166136261u;
-  while (*str) {
-    hash ^= (uint8_t)*str++;
-    hash *= 16777619u;
-  }
-  return hash;
+int trackFieldValue(metaData_t *md, uint32_t fieldNum, const char *value)
+{
+  if (value == NULL)
+    return 0;
+  return trackFieldValueLen(md, fieldNum, value, strlen(value));
 }
 
+/****
+ *
+ * Hash set implementation for field value tracking
+ *
+ ****/
+
 /* Create a new hash set with given initial capacity */
 field_hashset_t *field_hashset_create(uint32_t initial_capacity) {
   field_hashset_t *hs;
@@ -938,9 +1376,9 @@ field_hashset_t *field_hashset_create(uint32_t initial_capacity) {
   if (!hs)
     return NULL;
   
-  hs->buckets = (const char **)XMALLOC(capacity * sizeof(const char *));
+  hs->buckets = (field_value_t *)XMALLOC(capacity * sizeof(field_value_t));
   if (hs->buckets) {
-    XMEMSET(hs->buckets, 0, capacity * sizeof(const char *));
+    XMEMSET(hs->buckets, 0, capacity * sizeof(field_value_t));
   }
   if (!hs->buckets) {
     XFREE(hs);
@@ -966,11 +1404,10 @@ void field_hashset_destroy(field_hashset_t *hs) {
 }
 
 /* Check if value exists or add it to the hash set */
-int field_hashset_contains_or_add(field_hashset_t *hs, const char *interned_str) {
-  uint32_t hash;
+int field_hashset_contains_or_add(field_hashset_t *hs, field_value_t value) {
   uint32_t index, probe;
   
-  if (!hs || !interned_str)
+  if (!hs || !value)
     return 0;
   
   /* Check if we need to resize (load factor > 0.75) */
@@ -978,13 +1415,12 @@ int field_hashset_contains_or_add(field_hashset_t *hs, const char *interned_str)
     field_hashset_resize(hs);
   }
   
-  hash = field_hash_string(interned_str);
-  index = hash & (hs->capacity - 1);  /* Fast modulo for power of 2 */
+  index = FIELD_VALUE_HASH(value) & (hs->capacity - 1);  /* Fast modulo for power of 2 */
   probe = 0;
   
   /* Linear probing with Robin Hood hashing */
-  while (hs->buckets[index] != NULL) {
-    if (hs->buckets[index] == interned_str) {
+  while (hs->buckets[index] != 0) {
+    if (hs->buckets[index] == value) {
       return 0;  /* Already exists */
     }
     
@@ -1001,7 +1437,7 @@ int field_hashset_contains_or_add(field_hashset_t *hs, const char *interned_str)
   }
   
   /* Add new value */
-  hs->buckets[index] = interned_str;
+  hs->buckets[index] = value;
   hs->count++;
   
   return 1;  /* Successfully added */
@@ -1009,7 +1445,7 @@ int field_hashset_contains_or_add(field_hashset_t *hs, const char *interned_str)
 
 /* Resize hash set when load factor is too high */
 void field_hashset_resize(field_hashset_t *hs) {
-  const char **old_buckets;
+  field_value_t *old_buckets;
   uint32_t old_capacity, i;
   
   if (!hs || hs->capacity >= 0x40000000)  /* Max capacity 1GB entries */
@@ -1020,9 +1456,9 @@ void field_hashset_resize(field_hashset_t *hs) {
   
   /* Double the capacity */
   hs->capacity <<= 1;
-  hs->buckets = (const char **)XMALLOC(hs->capacity * sizeof(const char *));
+  hs->buckets = (field_value_t *)XMALLOC(hs->capacity * sizeof(field_value_t));
   if (hs->buckets) {
-    XMEMSET(hs->buckets, 0, hs->capacity * sizeof(const char *));
+    XMEMSET(hs->buckets, 0, hs->capacity * sizeof(field_value_t));
   }
   
   if (!hs->buckets) {
@@ -1038,7 +1474,7 @@ void field_hashset_resize(field_hashset_t *hs) {
   
   /* Re-insert all values */
   for (i = 0; i < old_capacity; i++) {
-    if (old_buckets[i] != NULL) {
+    if (old_buckets[i] != 0) {
       field_hashset_contains_or_add(hs, old_buckets[i]);
     }
   }
@@ -1085,9 +1521,10 @@ void freeField(struct Fields_s *field)
       break;
   }
   
-  /* Reset all fields */
+  hllFree(&field->hll);
+
+  /* Reset all fields, the value belongs to the interner */
   field->count = 0;
+  field->value = NULL;
   field->storage_type = FIELD_STORAGE_INLINE;
-  field->is_variable = 0;
-  field->tracking_enabled = 0;
 }
@@ -31,6 +31,16 @@
 
 #define LINEBUF_SIZE 4096
 
+/* report order (--sort), SORT_NONE is hash order */
+#define SORT_NONE 0
+#define SORT_COUNT 1             /* least seen first, like 'sort -n' */
+#define SORT_FIRST_SEEN 2
+#define SORT_TEMPLATE 3
+
+/* digit width of the report radix sort */
+#define SORT_RADIX_BITS 11
+#define SORT_RADIX_SIZE (1 << SORT_RADIX_BITS)
+
 /****
  *
  * includes
@@ -52,8 +62,13 @@
 #include "util.h"
 #include "mem.h"
 #include "parser.h"
+#include "parser_interface.h"
+#include "output.h"
+#include "templatedb.h"
+#include "hll.h"
 #include "match.h"
 #include "string_intern.h"
+#include "input.h"
 
 /****
  *
@@ -68,19 +83,26 @@
  ****/
 
 /* Storage types for field values */
-#define FIELD_STORAGE_INLINE  0  /* Using inline array (count <= 8) */
-#define FIELD_STORAGE_DYNAMIC 1  /* Using dynamic array (8 < count <= 32) */
+#define FIELD_STORAGE_INLINE  0  /* Using inline array (count <= 4) */
+#define FIELD_STORAGE_DYNAMIC 1  /* Using dynamic array (4 < count <= 32) */
 #define FIELD_STORAGE_HASHSET 2  /* Using hash set (count > 32) */
 
-/* Inline array size - optimized for cache line */
-#define FIELD_INLINE_SIZE 8
+/* Inline array size - covers the default cluster depth */
+#define FIELD_INLINE_SIZE 4
 
 /* Threshold to switch from dynamic array to hash set */
 #define FIELD_HASHSET_THRESHOLD 32
 
+/* A distinct field value, compared by hash and length instead of being kept */
+typedef uint64_t field_value_t;
+
+/* hashKey() of the value above its length + 1, 0 marks an empty hash set bucket */
+#define FIELD_VALUE_KEY(hash, len) (((uint64_t)(hash) << 16) | (((uint64_t)(len) + 1) & 0xffff))
+#define FIELD_VALUE_HASH(key) ((uint32_t)((key) >> 16))
+
 /* Simple hash set for field values */
 typedef struct {
-  const char **buckets;    /* Array of interned string pointers */
+  field_value_t *buckets;
   uint32_t capacity;        /* Power of 2 for fast modulo */
   uint32_t count;          /* Number of entries (32-bit to handle millions) */
   uint16_t max_probe;      /* Maximum probe distance seen */
@@ -88,37 +110,60 @@ typedef struct {
 
 struct Fields_s
 {
-  uint32_t count;          /* Number of unique values stored (32-bit to handle millions) */
+  uint32_t count;          /* Number of unique values seen, up to clusterDepth + 1 */
   uint8_t storage_type;    /* INLINE, DYNAMIC, or HASHSET */
-  uint8_t is_variable;     /* 1 if field is variable (too many values) */
-  uint8_t tracking_enabled; /* 1 if still tracking new values */
-  
+  const char *value;       /* first value, interned, printed while the field is invariant */
+
   union {
-    /* For small counts (<=8): inline array */
-    const char *inline_values[FIELD_INLINE_SIZE];
+    /* For small counts (<=4): inline array */
+    field_value_t inline_values[FIELD_INLINE_SIZE];
     
-    /* For medium counts (8-32): dynamic array */
+    /* For medium counts (4-32): dynamic array */
     struct {
-      const char **values;
+      field_value_t *values;
       uint16_t capacity;
     } dynamic;
     
     /* For large counts (>32): hash set */
     field_hashset_t *hashset;
   } storage;
-  
-  struct Fields_s *next;   /* Next field in linked list */
+
+  hll_t hll;               /* distinct values of every occurrence, with -e */
 };
 
+/* words in a bitset of n fields */
+#define FIELD_BITSET_WORDS(n) (((size_t)(n) + 63) / 64)
+
 typedef struct
 {
-  char lBuf[LINEBUF_SIZE];
   size_t count;
-  struct Fields_s *head;
+  struct Fields_s *fields; /* one per field of the template, cluster mode only */
+  uint64_t *tracking;      /* bit set while a field is tracking values, clear once it proved variable */
+  uint64_t firstSeen;      /* input position of the sample line, see inputSeq */
+  uint32_t fieldCount;
   uint8_t all_fields_stopped_tracking; /* 1 if all fields have stopped tracking */
   uint8_t template_complete; /* 1 if this template has enough field samples */
+  char lBuf[];             /* sample line, nul terminated, at most LINEBUF_SIZE - 1 */
 } metaData_t;
 
+/* block of template records and their sample lines, see newMetaData() */
+#define MD_BLOCK_SIZE (1024 * 1024)
+
+struct mdBlock_s
+{
+  struct mdBlock_s *next;
+  size_t size;
+  size_t used;
+  char data[];
+};
+
+/* template to report with its sort key */
+struct sortRec_s
+{
+  uint64_t key;
+  const struct hashRec_s *rec;
+};
+
 /****
  *
  * function prototypes
@@ -127,19 +172,34 @@ typedef struct
 
 int printTemplate(const struct hashRec_s *hashRec);
 int processFile(const char *fName);
+int storeTemplate(ParserInterface *parser, parser_ctx_t *ctx, int fieldCount, char *line, size_t len);
 int showTemplates(void);
 int loadTemplateFile(const char *fName);
 char *clusterTemplate(char *template, metaData_t *md, char *oBuf, int bufSize);
+metaData_t *newMetaData(const char *line, size_t len, uint32_t fieldCount);
+void freeMetaData(void);
 
 /* Hybrid field tracking functions */
 void initField(struct Fields_s *field);
-int trackFieldValue(struct Fields_s *field, const char *value);
+int trackFieldValue(metaData_t *md, uint32_t fieldNum, const char *value);
+int trackFieldValueLen(metaData_t *md, uint32_t fieldNum, const char *value, size_t len);
 void freeField(struct Fields_s *field);
 
 /* Hash set helper functions */
 field_hashset_t *field_hashset_create(uint32_t initial_capacity);
 void field_hashset_destroy(field_hashset_t *hs);
-int field_hashset_contains_or_add(field_hashset_t *hs, const char *interned_str);
+int field_hashset_contains_or_add(field_hashset_t *hs, field_value_t value);
 void field_hashset_resize(field_hashset_t *hs);
 
+/****
+ *
+ * TRUE while a field of a template is still tracking values
+ *
+ ****/
+
+static inline int fieldTracking(const metaData_t *md, uint32_t fieldNum)
+{
+  return (int)((md->tracking[fieldNum >> 6] >> (fieldNum & 63)) & 1);
+}
+
 #endif /* TMPLTR_DOT_H */
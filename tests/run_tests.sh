@@ -124,6 +124,13 @@ if [ ! -x "$TMPLTR" ]; then
     exit 1
 fi
 
+# Generate test data if needed, tests comparing two runs pass on missing input
+if [ ! -f "data/basic.log" ] || [ ! -f "data/perf_100k.log" ]; then
+    echo "Generating test data..."
+    scripts/generate_test_data.sh
+    echo
+fi
+
 # =============================================================================
 # BASIC FUNCTIONALITY TESTS
 # =============================================================================
@@ -150,11 +157,56 @@ run_test "template_match" \
     "$TMPLTR -m '%s %d %s' data/basic.log" \
     "expected/template_match.out"
 
+# Test 4a: Every line matches the templates built from its own file
+run_test "match_lines" \
+    "diff <($TMPLTR -L data/basic.log data/basic.log) data/basic.log" \
+    ""
+
 # Test 5: Ignore quotes
 run_test "ignore_quotes" \
     "$TMPLTR -g data/quoted.log" \
     "expected/ignore_quotes.out"
 
+# Test 5a: Threaded clustering matches the single threaded run once sorted
+run_test "cluster_threads" \
+    "diff <($TMPLTR -c data/basic.log | sort) <($TMPLTR -T 4 -c data/basic.log | sort)" \
+    ""
+
+# Test 5b: Follow mode prints the first line of every new template
+run_test "follow_stdin" \
+    "diff <($TMPLTR -f -q - < data/basic.log 2>/dev/null | sed 's/||.*//' | sort) <($TMPLTR data/basic.log | sed 's/^ *[0-9]* //; s/||.*//' | sort)" \
+    ""
+
+# Test 5c: Compressed input is detected and decompressed
+run_test "cluster_gzip" \
+    "diff <($TMPLTR -c data/basic.log) <(gzip -c data/basic.log | $TMPLTR -c -)" \
+    ""
+
+# Test 5d: Shape cache replays give the same templates and cluster values
+run_test "shape_cache" \
+    "diff <(cat data/basic.log data/basic.log data/basic.log | $TMPLTR -c -) <(cat data/basic.log data/basic.log data/basic.log | $TMPLTR -S -c -)" \
+    ""
+
+# Test 5e: Field estimates are printed and merge to the same values across threads
+run_test "estimate_threads" \
+    "diff <($TMPLTR -e data/basic.log | grep '{~' | sort) <($TMPLTR -T 4 -e data/basic.log | grep '{~' | sort)" \
+    ""
+
+# Test 5f: Count sort is a stable ascending sort of the default output
+run_test "sort_count" \
+    "diff <($TMPLTR -s count data/basic.log) <($TMPLTR data/basic.log | sort -n -s -k1,1)" \
+    ""
+
+# Test 5g: Top prints only the most seen templates
+run_test "top_templates" \
+    "diff <(cat data/basic.log data/integers.log data/ip_addresses.log data/syslog_dates.log | $TMPLTR -H 2 - | awk '{print \$1}') <(cat data/basic.log data/integers.log data/ip_addresses.log data/syslog_dates.log | $TMPLTR - | awk '{print \$1}' | sort -rn | head -2)" \
+    ""
+
+# Test 5h: Bottom prints only the least seen templates
+run_test "bottom_templates" \
+    "diff <(cat data/basic.log data/integers.log data/ip_addresses.log data/syslog_dates.log | $TMPLTR -B 2 - | awk '{print \$1}') <(cat data/basic.log data/integers.log data/ip_addresses.log data/syslog_dates.log | $TMPLTR - | awk '{print \$1}' | sort -n | head -2)" \
+    ""
+
 # =============================================================================
 # FIELD TYPE DETECTION TESTS
 # =============================================================================
@@ -234,6 +286,11 @@ run_test "syslog_line_start" \
     "$TMPLTR data/syslog_position.log" \
     "expected/syslog_position.out"
 
+# Test 18a: Date lookahead that ends exactly at the end of the line
+run_test "date_lookahead_line_end" \
+    "diff <(echo 'at 2020-12-14 00:1' | $TMPLTR - | sed 's/||.*//') <(echo '           1 %s %s %s')" \
+    ""
+
 # =============================================================================
 # EDGE CASES AND ERROR HANDLING
 # =============================================================================
@@ -278,6 +335,16 @@ run_test "load_templates" \
     "$TMPLTR -t data/ignore_templates.txt data/basic.log" \
     "expected/filtered.out"
 
+# Test 24a: A binary template database filters the same as the text template file
+run_test "template_db_roundtrip" \
+    "$TMPLTR -w $TEST_OUTPUT_DIR/t.txt data/basic.log > /dev/null && $TMPLTR -b -w $TEST_OUTPUT_DIR/t.db data/basic.log > /dev/null && diff <(cat data/basic.log data/integers.log | $TMPLTR -t $TEST_OUTPUT_DIR/t.db -) <(cat data/basic.log data/integers.log | $TMPLTR -t $TEST_OUTPUT_DIR/t.txt -)" \
+    ""
+
+# Test 24b: Writing over a database loaded with -t is refused
+run_test "template_db_same_file" \
+    "cp $TEST_OUTPUT_DIR/t.db $TEST_OUTPUT_DIR/same.db && ! $TMPLTR -t $TEST_OUTPUT_DIR/same.db -b -w $TEST_OUTPUT_DIR/same.db data/basic.log 2> /dev/null && cmp $TEST_OUTPUT_DIR/t.db $TEST_OUTPUT_DIR/same.db" \
+    ""
+
 # =============================================================================
 # PERFORMANCE TESTS
 # =============================================================================
@@ -285,12 +352,6 @@ echo
 echo ">>> Performance Tests"
 echo
 
-# Generate test data if needed
-if [ ! -f "data/perf_1m.log" ]; then
-    echo "Generating performance test data..."
-    scripts/generate_test_data.sh
-fi
-
 # Test 25: Non-clustering performance (expect >500K lines/min)
 run_perf_test "perf_no_cluster" \
     "$TMPLTR data/perf_100k.log" \